@@ -73,9 +73,10 @@ public:
      * @brief Returns a string with a list of characters, each one representing 
      * a nucleotide of this Kmer.
      * Query method
-     * @return The text of this Kmer as a string object
+     * @return A reference to the text of this Kmer. It does not make a copy,
+     * so comparing Kmer objects through it does not allocate memory
      */
-    std::string toString() const;
+    const std::string& toString() const;
 
     /**
      * @brief Gets a const reference to the character (nucleotide) at the given 
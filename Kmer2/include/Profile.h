@@ -224,6 +224,8 @@ CT 4
 CT 9
 _G 5
      * 
+     * The repeated kmers are merged in a single pass with a hash map of the
+     * previous ones, keeping the order of their first occurrences.
      * Modifier method
      * @param validNucleotides a string with the list of characters (nucleotides) 
      * that should be considered as valid. Input parameter
@@ -258,6 +260,7 @@ _G 5
      * KmerFreq objects with a frequency less or equals to this value, are 
      * deleted. This parameter has zero as default value.
      * Input parameter
+     * The kept objects are compacted in a single pass, keeping their order.
      */
     void zip(bool deleteMissing=false, int lowerBound = 0);
     
@@ -54,7 +54,7 @@ int Kmer::size() const {
     return _text.size();
 }
 
-std::string Kmer::toString() const {
+const std::string& Kmer::toString() const {
     
     return _text;
 }
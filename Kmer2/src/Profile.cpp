@@ -15,6 +15,7 @@
 
 
 #include <fstream>
+#include <unordered_map>
 
 #include "Profile.h"
 
@@ -243,12 +244,9 @@ void Profile::load(const char fileName[]) {
                         
                         std::string kmer;
                         int frequency;
-                        size_t found;
                         
                         input >> kmer;
                         input >> frequency;
-                        
-                        found = findKmer(Kmer(kmer));
                             
                         _vectorKmerFreq[i].setFrequency(frequency);
                         _vectorKmerFreq[i].setKmer(Kmer(kmer));
@@ -300,21 +298,36 @@ void Profile::normalize(const std::string& validNucleotides) {
         _vectorKmerFreq[i].setKmer(kmer);
     }
     
-    size_t index;
-    int i = 1;
-    
-    while (i < _size) {
-       
-       index = findKmer(_vectorKmerFreq[i].getKmer(), 0, i - 1);
-        
-       if (index != std::string::npos) {
-           
-           _vectorKmerFreq[index].setFrequency(_vectorKmerFreq[index].getFrequency() + _vectorKmerFreq[i].getFrequency());
-           deletePos(i);
-       }
-       
-       else i++;
-   } 
+    // Each kmer is searched in a hash map with the position of the kmers
+    // kept before it: if it is found, its frequency is added to the first
+    // occurrence; otherwise, it is moved to the next kept position
+    std::unordered_map<std::string, int> positions;
+    positions.reserve(_size);
+    int kept = 0;
+    
+    for (int i = 0; i < _size; i++) {
+        
+        std::pair<std::unordered_map<std::string, int>::iterator, bool> inserted = 
+                positions.insert(std::make_pair(_vectorKmerFreq[i].getKmer().toString(), kept));
+        
+        if (!inserted.second) {
+            
+            KmerFreq& first = _vectorKmerFreq[inserted.first->second];
+            first.setFrequency(first.getFrequency() + _vectorKmerFreq[i].getFrequency());
+        }
+        
+        else {
+            
+            if (kept != i) {
+                
+                _vectorKmerFreq[kept] = _vectorKmerFreq[i];
+            }
+            
+            kept++;
+        }
+    }
+    
+    _size = kept;
 }
 
 void Profile::deletePos(int pos) {
@@ -342,18 +355,25 @@ void Profile::deletePos(int pos) {
 
 void Profile::zip(bool deleteMissing, int lowerBound) {
     
-    int i = 0;
+    // The kept objects are moved from the reading position (i) to the 
+    // writing position (kept), in a single pass
+    int kept = 0;
   
-    while (i < _size) {
+    for (int i = 0; i < _size; i++) {
         
-        if ((deleteMissing && (_vectorKmerFreq[i].getKmer().toString().find(Kmer().MISSING_NUCLEOTIDE) != std::string::npos))||
-            (_vectorKmerFreq[i].getFrequency() <= lowerBound)) {
+        if (!((deleteMissing && (_vectorKmerFreq[i].getKmer().toString().find(Kmer().MISSING_NUCLEOTIDE) != std::string::npos))||
+            (_vectorKmerFreq[i].getFrequency() <= lowerBound))) {
 
-            deletePos(i);
+            if (kept != i) {
+                
+                _vectorKmerFreq[kept] = _vectorKmerFreq[i];
+            }
+            
+            kept++;
         }
-        
-        else i++;
-    }   
+    }
+    
+    _size = kept;
 } 
 
 void Profile::join(const Profile& profile) {
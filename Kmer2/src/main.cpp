@@ -13,7 +13,11 @@
  * Created on 31 October de 2023, 14:30
  */
 
+#include <algorithm>
 #include <iostream>
+#include <queue>
+#include <vector>
+
 #include "Profile.h"
 
 /**
@@ -36,10 +40,113 @@ void showEnglishHelp(std::ostream& outputStream) {
     outputStream << std::endl;
 }
 
+/**
+ * Loads and normalizes the Profile in the given file, and gets its pairs
+ * sorted by alphabetical order of kmers
+ * @param fileName The name of the file with the Profile. Input parameter
+ * @param validNucleotides The valid nucleotides used to normalize the
+ * Profile. Input parameter
+ * @param profileId The identifier of the Profile. Output parameter
+ * @param kmerFreqs The pairs of the normalized Profile, sorted by kmer.
+ * Output parameter
+ */
+void loadSortedKmers(const char fileName[], const std::string& validNucleotides,
+        std::string& profileId, std::vector<KmerFreq>& kmerFreqs) {
+    
+    Profile profile;
+    profile.load(fileName);
+    profile.normalize(validNucleotides);
+    profileId = profile.getProfileId();
+    
+    kmerFreqs.clear();
+    kmerFreqs.reserve(profile.getSize());
+    
+    for (int i = 0; i < profile.getSize(); i++) {
+        
+        kmerFreqs.push_back(profile.at(i));
+    }
+    
+    std::sort(kmerFreqs.begin(), kmerFreqs.end(), 
+            [](const KmerFreq& first, const KmerFreq& second) {
+                return first.getKmer().toString() < second.getKmer().toString();
+            });
+}
+
+/**
+ * Merges the given lists of pairs, each one sorted by kmer and without
+ * repeated kmers, with a k-way merge: a heap keeps the next pair of each 
+ * list, and the frequencies of the same kmer in different lists are added
+ * as the kmer is taken from the heap. 
+ * @param kmerFreqs The lists of pairs, sorted by kmer. Input parameter
+ * @param profileId The identifier of the resulting Profile. Input parameter
+ * @return A Profile with a pair for each kmer in the given lists, sorted by 
+ * kmer, whose frequency is the sum of its frequencies in the lists
+ * @throw std::out_of_range Throws a std::out_of_range exception if the 
+ * number of different kmers is greater than the capacity of a Profile
+ */
+Profile mergeSortedKmers(const std::vector<std::vector<KmerFreq> >& kmerFreqs,
+        const std::string& profileId) {
+    
+    // A cursor is formed by the list and the position of its next pair. The
+    // heap gives the cursor with the smallest kmer first
+    typedef std::pair<int, int> Cursor;
+    auto greater = [&kmerFreqs](const Cursor& first, const Cursor& second) {
+        return kmerFreqs[first.first][first.second].getKmer().toString() > 
+                kmerFreqs[second.first][second.second].getKmer().toString();
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(greater);
+    
+    for (size_t i = 0; i < kmerFreqs.size(); i++) {
+        
+        if (!kmerFreqs[i].empty()) {
+            
+            heap.push(Cursor(i, 0));
+        }
+    }
+    
+    std::vector<KmerFreq> merged;
+    
+    while (!heap.empty()) {
+        
+        Cursor cursor = heap.top();
+        heap.pop();
+        const KmerFreq& kmerFreq = kmerFreqs[cursor.first][cursor.second];
+        
+        if (!merged.empty() && 
+                merged.back().getKmer().toString() == kmerFreq.getKmer().toString()) {
+            
+            merged.back().setFrequency(merged.back().getFrequency() + kmerFreq.getFrequency());
+        }
+        
+        else {
+            
+            merged.push_back(kmerFreq);
+        }
+        
+        if (cursor.second + 1 < static_cast<int>(kmerFreqs[cursor.first].size())) {
+            
+            heap.push(Cursor(cursor.first, cursor.second + 1));
+        }
+    }
+    
+    Profile profile(merged.size());
+    profile.setProfileId(profileId);
+    
+    for (size_t i = 0; i < merged.size(); i++) {
+        
+        profile.at(i) = merged[i];
+    }
+    
+    return profile;
+}
+
 /**
  * This program reads and normalizes an undefined number of Profile objects 
  * from the input files passed as parameters to main(). These normalized Profile 
- * objects are used to obtain the union of them, the join Profile. The join 
+ * objects are used to obtain the union of them, the join Profile: the pairs
+ * of each Profile are sorted by kmer, and then all of them are merged at 
+ * once, adding the frequencies of the same kmer (see mergeSortedKmers()). 
+ * The join 
  * Profile is then zipped (pairs with frequency less or equals to zero are 
  * deleted) and sorted by decreasing order of frequency. In that order,
  * if there is any tie in frequencies, then alphabetical order of kmers is
@@ -83,20 +190,28 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Load and normalize the first input Profile file
-    Profile profile;
-    profile.load(argv[2]);
-    profile.normalize(VALID_NUCLEOTIDES);  
+    // Load and normalize each input Profile file, and sort its pairs by kmer.
+    // The files with a profile identifier different from the one of the 
+    // first file are not included
+    std::string profileId;
+    std::vector<std::vector<KmerFreq> > kmerFreqs(1);
+    loadSortedKmers(argv[2], VALID_NUCLEOTIDES, profileId, kmerFreqs[0]);
     
-    // Use a loop to load, normalize and obtain the join with the rest of Profiles
     for (int i = 3; i < argc; i++) {
         
-        Profile tmp;
-        tmp.load(argv[i]);
-        tmp.normalize(VALID_NUCLEOTIDES);
-        profile.join(tmp);
+        std::string id;
+        kmerFreqs.push_back(std::vector<KmerFreq>());
+        loadSortedKmers(argv[i], VALID_NUCLEOTIDES, id, kmerFreqs.back());
+        
+        if (id != profileId) {
+            
+            kmerFreqs.pop_back();
+        }
     }
     
+    // Obtain the join Profile merging the sorted pairs of all the files
+    Profile profile = mergeSortedKmers(kmerFreqs, profileId);
+    
     // Zip the resulting Profile
     profile.zip();
     
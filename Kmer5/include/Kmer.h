@@ -16,6 +16,7 @@
 #ifndef KMER_H
 #define KMER_H
 
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -73,9 +74,10 @@ public:
      * @brief Returns a string with a list of characters, each one representing 
      * a nucleotide of this Kmer.
      * Query method
-     * @return The text of this Kmer as a string object
+     * @return A reference to the text of this Kmer. It does not make a copy,
+     * so comparing Kmer objects through it does not allocate memory
      */
-    std::string toString() const;
+    const std::string& toString() const;
 
     /**
      * @brief Gets a const reference to the character (nucleotide) at the given 
@@ -216,4 +218,22 @@ bool operator>(const Kmer& kmer1, const Kmer& kmer2);
 
 bool operator==(const Kmer& kmer1, const Kmer& kmer2);
 
+namespace std {
+
+/**
+ * @brief Hash function for Kmer objects, so they can be used as keys of
+ * std::unordered_map and std::unordered_set. Two equal Kmer objects (see
+ * operator==()) have the same hash value
+ */
+template <>
+struct hash<Kmer> {
+
+    size_t operator()(const Kmer& kmer) const {
+
+        return hash<string>()(kmer.toString());
+    }
+};
+
+} // end namespace std
+
 #endif /* KMER_H */
\ No newline at end of file
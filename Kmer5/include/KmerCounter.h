@@ -16,15 +16,19 @@
 #ifndef KMER_COUNTER_H
 #define KMER_COUNTER_H
 
+#include <istream>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "KmerHashTable.h"
 #include "Profile.h"
 
 /**
- * @class KmerCounter
+ * @class BasicKmerCounter
  * @brief It is a helper class used to calculate the frequency of each kmer in
  * a text file. 
- * It consists of a matrix of integers. Each element in the matrix contains
+ * It consists of a matrix of integers (of type Cell). Each element in the matrix contains
  * the frequency of the kmer that is defined by its row and column: the kmer formed 
  * taking the nucleotides defined by the row and column of that element. 
  * 
@@ -50,8 +54,31 @@
  * When searching for kmers in a text file, if we find a character that 
  * does not belong to the set of valid nucleotides, it will be replaced by the 
  * character Kmer::MISSING_NUCLEOTIDE in the corresponding kmer
+ * 
+ * The frequency matrix needs an element for each possible kmer, so its size
+ * grows exponentially with _k. For this reason, a KmerCounter can be built 
+ * with a sparse storage: the frequencies are saved in a hash table 
+ * (KmerHashTable _table) that only contains the kmers found, using as key 
+ * the code of each kmer, that is, the position of its element in the 
+ * frequency matrix (row * getNumCols() + column). In that case, the matrix is
+ * not allocated, getNumRows() and getNumCols() return 0 and the operator() 
+ * can not be used.
+ * 
+ * A KmerCounter can also be built to skip the kmers with invalid 
+ * nucleotides instead of counting them with the missing nucleotide. In that
+ * case, the codes of the kmers (and the rows and columns of the frequency 
+ * matrix) only use the characters of _validNucleotides, so the number of
+ * possible kmers is |_validNucleotides|^k instead of |_allNucleotides|^k.
+ * 
+ * The type of the elements of the frequency matrix (Cell) can be any integer
+ * type (unsigned char, unsigned short, int and long long are instantiated).
+ * A smaller type reduces the memory used by the matrix. An element does not
+ * overflow: when it reaches the maximum value of Cell, it stays with that 
+ * value and the rest of the frequency is kept in the hash table _spill. 
+ * KmerCounter is a BasicKmerCounter with elements of type int.
  */
-class KmerCounter {
+template <class Cell>
+class BasicKmerCounter {
 public:
 
     /**
@@ -63,6 +90,38 @@ public:
      */
     static const char* const DEFAULT_VALID_NUCLEOTIDES;
 
+    /**
+     * Number of different values of a char. It is the size of the 
+     * translation table that converts characters into indexes of 
+     * _allNucleotides
+     */
+    static const int NUM_CHARACTERS = 256;
+
+    /**
+     * Value of the translation table (see getNucleotideCodes()) for the 
+     * characters that end a genetic sequence (whitespaces)
+     */
+    static const unsigned char SEQUENCE_END = 255;
+
+    /**
+     * Value of the translation table (see getNucleotideCodes()) for the 
+     * invalid nucleotides when the kmers with invalid nucleotides are skipped
+     */
+    static const unsigned char INVALID_NUCLEOTIDE = 254;
+
+    /**
+     * Default number of characters that are read from the input file in
+     * each block by calculateFrequencies()
+     */
+    static const int DEFAULT_BLOCK_SIZE = 8 * 1024 * 1024;
+
+    /**
+     * Maximum number of possible kmers (elements of the frequency matrix) for
+     * which IsSparseBetter() recommends a frequency matrix of elements of 
+     * type int. It is scaled by the size of Cell for other types
+     */
+    static const long long MAX_DENSE_KMERS = 16 * 1024 * 1024;
+
     /**
      * @brief Constructor of the class. This object uses a matrix of 
      * integers that contains the frequency for each kmer. Each element of the 
@@ -73,21 +132,98 @@ public:
      * @param k The number of nucleotides in each kmer. Input parameter
      * @param validNucleotides The set of nucleotides (characters) that are 
      * considered as part of a kmer. Input parameter
+     * @param sparse true to save the frequencies in a hash table instead of
+     * a matrix. Input parameter
+     * @param skipMissing true to skip the kmers with invalid nucleotides 
+     * when counting the kmers of a file, instead of counting them with the
+     * missing nucleotide. Then, the kmers with the missing nucleotide can not
+     * be stored in this object. Input parameter
+     * @throw std::invalid_argument Throws a std::invalid_argument if 
+     * @p k is less than 1, or if @p sparse is true and the codes of the 
+     * kmers do not fit in an unsigned long long (see GetNumCodes())
      */
-    KmerCounter(int k=5, 
-       const std::string& validNucleotides = DEFAULT_VALID_NUCLEOTIDES);
+    BasicKmerCounter(int k=5, 
+       const std::string& validNucleotides = DEFAULT_VALID_NUCLEOTIDES,
+       bool sparse = false, bool skipMissing = false);
 
     /**
      * @brief Copy constructor
      * @param orig the KmerCounter object used as source for the copy. 
      * Input parameter
      */
-    KmerCounter(const KmerCounter& orig);
+    BasicKmerCounter(const BasicKmerCounter& orig);
 
     /**
      * @brief Destructor
      */
-    ~KmerCounter();
+    ~BasicKmerCounter();
+
+    /**
+     * @brief Decides if a KmerCounter with the given parameters should use
+     * a sparse storage, that is, if the number of possible kmers is greater
+     * than MAX_DENSE_KMERS
+     * @param k The number of nucleotides in each kmer. Input parameter
+     * @param validNucleotides The set of valid nucleotides. Input parameter
+     * @param skipMissing true if the kmers with invalid nucleotides are
+     * skipped. Input parameter
+     * @return true if a sparse storage is recommended; false otherwise
+     */
+    static bool IsSparseBetter(int k, const std::string& validNucleotides,
+       bool skipMissing = false);
+
+    /**
+     * @brief Returns the number of possible kmers (including the missing
+     * nucleotide, unless @p skipMissing is true) with the given parameters,
+     * or 0 if it is not less than the maximum value of an unsigned long long
+     * (KmerHashTable::EMPTY_KEY)
+     * @param k The number of nucleotides in each kmer. Input parameter
+     * @param validNucleotides The set of valid nucleotides. Input parameter
+     * @param skipMissing true if the kmers with invalid nucleotides are
+     * skipped. Input parameter
+     * @return The number of possible kmers, or 0 if it is too big
+     */
+    static unsigned long long GetNumCodes(int k, 
+       const std::string& validNucleotides, bool skipMissing = false);
+
+    /**
+     * @brief Checks if the frequencies are saved in a hash table instead of
+     * a matrix
+     * Query method
+     * @return true if the storage of this object is sparse; false otherwise
+     */
+    bool isSparse() const;
+
+    /**
+     * @brief Checks if the kmers are counted in canonical mode (see 
+     * setCanonical())
+     * Query method
+     * @return true if the kmers are counted in canonical mode; false otherwise
+     */
+    bool isCanonical() const;
+
+    /**
+     * @brief Sets the canonical mode. In canonical mode, calculateFrequencies()
+     * and addFrequencies() count each kmer of a file together with its
+     * reverse complement (the complementary kmer read backwards), 
+     * increasing the frequency of the one with the smaller code (its 
+     * position in the frequency matrix). In this way, a sequence and its 
+     * reverse complement (the other strand) obtain the same frequencies.
+     * The complementary pairs are A-T (A-U if T is not a valid nucleotide)
+     * and C-G; any other nucleotide is its own complement. The other methods
+     * are not affected by this mode.
+     * Modifier method
+     * @param canonical true to count in canonical mode. Input parameter
+     */
+    void setCanonical(bool canonical);
+
+    /**
+     * @brief Checks if the kmers with invalid nucleotides are skipped when
+     * counting the kmers of a file
+     * Query method
+     * @return true if the kmers with invalid nucleotides are skipped; false
+     * if they are counted with the missing nucleotide
+     */
+    bool isSkippingMissing() const;
 
     /**
      * @brief Returns the number of nucleotides that can be part of a
@@ -108,12 +244,13 @@ public:
     
     /**
      * @brief Returns the number of different kmers that can be built using
-     * @p _k nucleotides (including the missing nucleotide)
+     * @p _k nucleotides (including the missing nucleotide, unless the kmers 
+     * with invalid nucleotides are skipped)
      * Query method
      * @return The number of different kmers that can be built using
      * @p _k nucleotides 
      */
-    int getNumKmers() const;
+    long long getNumKmers() const;
     
 
     /**
@@ -129,7 +266,9 @@ public:
      * the value of _k (number of nucleotides in each kmer) separated by a 
      * whitespace.
      * - In the following lines, each one of the rows in the frequency matrix
-     * (frequencies separated by a whitespace).
+     * (frequencies separated by a whitespace). If the storage is sparse,
+     * each line contains a kmer with a frequency greater than 0 and its 
+     * frequency, in increasing order of code.
      * Query method
      * @return A string with the content of this object
      */
@@ -148,7 +287,7 @@ public:
      * @param frequency The quantity that will be added to the current 
      * frequency. Input parameter
      */
-    void increaseFrequency(const Kmer& kmer, int frequency = 1);
+    void increaseFrequency(const Kmer& kmer, long long frequency = 1);
 
     /**
      * @brief Overloading of the assignment operator.
@@ -157,7 +296,7 @@ public:
      * Input parameter
      * @return A reference to this object
      */
-    KmerCounter& operator=(const KmerCounter& orig);
+    BasicKmerCounter& operator=(const BasicKmerCounter& orig);
 
     /**
      * @brief Overloading of the operator +=. It increases the current 
@@ -171,22 +310,111 @@ public:
      * kmers).
      * @return A reference to this object
      */
-    KmerCounter& operator+=(const KmerCounter& kc);
+    BasicKmerCounter& operator+=(const BasicKmerCounter& kc);
 
     /**
-     * @brief Reads the given text file and calculates the frequencies of each 
-     * kmer in that file. This method normalizes each found Kmer and then
-     * sum 1 at the corresponding element of the frequency matrix.
-     * This method sets to zero the frequency of each kmer before starting to 
-     * calculate frequencies. In this way, if this method is called twice 
+     * @brief Increases the current frequencies of the kmers of this object 
+     * with the frequencies of the kmers of the given object, as the 
+     * operator+=. The frequency matrix is divided into @p numThreads
+     * parts of consecutive elements, and each part is added in a different
+     * thread.
+     * Modifier method
+     * @param kc a KmerCounter object. Input parameter 
+     * @param numThreads The number of threads used. Input parameter
+     * @throw std::invalid_argument This method throws an 
+     * std::invalid_argument exception if the given argument @p kc has a different
+     * set of nucleotides or a different K (number of nucleotides in
+     * kmers), or if @p numThreads is less than 1.
+     * @return A reference to this object
+     */
+    BasicKmerCounter& add(const BasicKmerCounter& kc, int numThreads = 1);
+
+    /**
+     * @brief Sets to zero the frequency of each kmer and then calculates the
+     * frequencies of each kmer in the given text file (see addFrequencies()).
+     * In this way, if this method is called twice 
      * consecutively, then this KmerCounter will contain only the frecuencies
      * calculated in the last call.
      * Modifier method
      * @param fileName The name of the file to process. Input parameter
+     * @param blockSize The number of characters read from the file in each
+     * block. Input parameter
+     * @param numThreads The number of threads used. Input parameter
+     * @throw std::ios_base::failure Throws a std::ios_base::failure if the
+     * given file cannot be opened
+     * @throw std::invalid_argument Throws a std::invalid_argument if 
+     * @p blockSize or @p numThreads are less than 1
+     */
+    void calculateFrequencies(const char* fileName, 
+       int blockSize = DEFAULT_BLOCK_SIZE, int numThreads = 1);
+
+    /**
+     * @brief Reads the given text file and increases the current frequency of
+     * each kmer with its frequency in that file. The genetic sequence is the
+     * first word of the file
+     * (whitespaces before it are skipped and the first whitespace after it
+     * ends the sequence).
+     * If the file is a regular file, it is mapped in memory (see MappedFile)
+     * and the kmers are counted directly from the pages of the file, without
+     * copying them. Otherwise (for example, a pipe), the file is read in 
+     * blocks of @p blockSize characters, so the
+     * memory used does not depend on the size of the file, and the kmers of 
+     * each block are counted before reading the next one. The last 
+     * nucleotides of each block are kept to count the kmers that cross the 
+     * boundary with the following block.
+     * This method normalizes each nucleotide only once,
+     * using the translation table given by getNucleotideCodes(), and keeps
+     * the index of the current kmer in the frequency matrix, which is 
+     * updated in constant time when moving to the next kmer. Then, it sums 1
+     * at the corresponding element of the frequency matrix.
+     * If @p numThreads is greater than 1, the sequence is divided into
+     * @p numThreads ranges of consecutive characters, and each range is 
+     * counted in a different thread, in its own frequency matrix. Each thread 
+     * starts reading k-1 characters before its range, to count the kmers that
+     * cross the boundary with the previous range. After that, the matrices
+     * are added to this object (see add()). The result is the same that the 
+     * one obtained with a single thread. If the file cannot be positioned
+     * (for example, a pipe), a single thread is used.
+     * This method allows to accumulate the frequencies of several files in 
+     * the same KmerCounter without using a temporary one for each file.
+     * Modifier method
+     * @param fileName The name of the file to process. Input parameter
+     * @param blockSize The number of characters read from the file in each
+     * block, when it is not mapped in memory. Input parameter
+     * @param numThreads The number of threads used. Input parameter
      * @throw std::ios_base::failure Throws a std::ios_base::failure if the
      * given file cannot be opened
+     * @throw std::invalid_argument Throws a std::invalid_argument if 
+     * @p blockSize or @p numThreads are less than 1
      */
-    void calculateFrequencies(const char* fileName);
+    void addFrequencies(const char* fileName, 
+       int blockSize = DEFAULT_BLOCK_SIZE, int numThreads = 1);
+
+    /**
+     * @brief Reads the given text file once and increases the frequencies of
+     * all the given KmerCounters, which may have different k, canonical mode
+     * and storage (dense or sparse), in the same way as addFrequencies().
+     * Each nucleotide is translated once, and each block is passed in turn to
+     * the rolling code of each KmerCounter while it is still in the cache.
+     * In this way, the profiles of several k (for example, 1 to 8) are 
+     * obtained with a single scan of the file.
+     * Modifier method
+     * @param counters The KmerCounters. All of them must have the same set of
+     * valid nucleotides and skip (or not) the missing ones. 
+     * Input/output parameter
+     * @param fileName The name of the file to process. Input parameter
+     * @param blockSize The number of characters read from the file in each
+     * block, when it is not mapped in memory. Input parameter
+     * @param numThreads The number of threads used. Input parameter
+     * @throw std::ios_base::failure Throws a std::ios_base::failure if the
+     * given file cannot be opened
+     * @throw std::invalid_argument Throws a std::invalid_argument if 
+     * @p blockSize or @p numThreads are less than 1, or if the KmerCounters
+     * have different valid nucleotides or ways of counting missing ones
+     */
+    static void AddFrequencies(const std::vector<BasicKmerCounter*>& counters,
+       const char* fileName, int blockSize = DEFAULT_BLOCK_SIZE, 
+       int numThreads = 1);
 
     /**
      * @brief Builds a Profile object from this KmerCounter object. The 
@@ -206,8 +434,24 @@ public:
      */
     Profile toProfile() const;
 
+    /**
+     * @brief Builds a sorted Profile object from this KmerCounter object. The
+     * result is the same as calling toProfile(), Profile::zip(deleteMissing)
+     * and Profile::sort(), but it is obtained in linear time: the kmers with
+     * a frequency greater than 0 are collected from the frequency matrix (or
+     * the hash table), sorted by decreasing frequency and increasing kmer 
+     * with a radix sort of their codes, and saved in a Profile with the 
+     * final size.
+     * Query method
+     * @param deleteMissing true to remove the kmers with the missing 
+     * nucleotide. Input parameter
+     * @return A Profile object from this KmerCounter object, sorted by
+     * decreasing frequency
+     */
+    Profile toSortedProfile(bool deleteMissing = false) const;
+
 //private:
-    int** _frequency; ///< 2D matrix with the frequency of each kmer
+    Cell** _frequency; ///< 2D matrix with the frequency of each kmer
     
     int _k; ///< Value of K (number of nucleotides in each kmer)
 
@@ -223,7 +467,30 @@ public:
      * (Kmer::MISSING_NUCLEOTIDE) and the set of valid nucleotides.
      */
     std::string _allNucleotides;
+
+    bool _sparse; ///< true if the frequencies are saved in _table
+
+    KmerHashTable _table; ///< Frequency of each kmer found (sparse storage)
+
+    /**
+     * Part of the frequency of the kmers that does not fit in an element of
+     * the frequency matrix (dense storage)
+     */
+    KmerHashTable _spill;
+
+    bool _canonical; ///< true if the kmers are counted in canonical mode
+
+    bool _skipMissing; ///< true if the kmers with invalid nucleotides are skipped
     
+    /**
+     * @brief Returns the nucleotides used as digits in the codes of the kmers
+     * and in the rows and columns of the matrix: _validNucleotides if the 
+     * kmers with invalid nucleotides are skipped, _allNucleotides otherwise
+     * Query method
+     * @return The nucleotides used in the codes of the kmers
+     */
+    const std::string& getCodeNucleotides() const;
+
     /**
      * @brief Returns the numbers of rows of the matrix in this object.
      * Query method
@@ -266,6 +533,148 @@ public:
      */
     std::string getInvertedIndex(int index, int nCharacters) const;
     
+    /**
+     * @brief Fills the given translation table with the index in 
+     * getCodeNucleotides() of every possible character. A character is first 
+     * converted to uppercase; if it does not belong to _validNucleotides, then
+     * it is translated to the index of Kmer::MISSING_NUCLEOTIDE (or to
+     * INVALID_NUCLEOTIDE if the kmers with invalid nucleotides are 
+     * skipped). In this way,
+     * each character of a genome is normalized with a single lookup.
+     * Whitespaces are translated to SEQUENCE_END.
+     * Query method
+     * @param codes An array with NUM_CHARACTERS elements. Output parameter
+     */
+    void getNucleotideCodes(unsigned char codes[]) const;
+
+    /**
+     * @brief Reads at most @p length characters from the given input stream,
+     * in blocks of @p blockSize characters, and increases in each
+     * KmerCounter of @p counters the frequencies of its kmers. It stops at 
+     * the first whitespace (end of the genetic sequence).
+     * @param input The input stream. Input/output parameter
+     * @param length The maximum number of characters to read. If it is
+     * negative, the stream is read until its end. Input parameter
+     * @param codes The translation table given by getNucleotideCodes().
+     * Input parameter
+     * @param blockSize The number of characters read in each block. 
+     * Input parameter
+     * @param overlap The number of characters at the start that belong to
+     * the previous range of the sequence: only the kmers that end after them
+     * are counted. Input parameter
+     * @param counters The KmerCounters. Output parameter
+     * @return true if a whitespace was found; false otherwise
+     */
+    static bool CountKmers(std::istream& input, long long length, 
+       const unsigned char codes[], int blockSize, long long overlap,
+       const std::vector<BasicKmerCounter*>& counters);
+
+    /**
+     * @brief Increases in each KmerCounter of @p counters the frequencies of
+     * its kmers found in the first @p length characters of the given array,
+     * translated in blocks of @p blockSize characters. It stops at the first
+     * whitespace (end of the genetic sequence).
+     * @param sequence An array of characters (for example, a file mapped in
+     * memory). Input parameter
+     * @param length The number of characters of the array. Input parameter
+     * @param codes The translation table given by getNucleotideCodes().
+     * Input parameter
+     * @param blockSize The number of characters translated in each block. 
+     * Input parameter
+     * @param overlap See the previous method. Input parameter
+     * @param counters The KmerCounters. Output parameter
+     * @return true if a whitespace was found; false otherwise
+     */
+    static bool CountKmers(const char* sequence, long long length, 
+       const unsigned char codes[], int blockSize, long long overlap,
+       const std::vector<BasicKmerCounter*>& counters);
+
+    /**
+     * @brief Increases in each KmerCounter of @p counters the frequencies of
+     * its kmers in a genetic sequence, whose nucleotides are translated (see 
+     * NucleotideTranslator) in blocks of @p blockSize characters by the 
+     * function read(buffer, size). It stops at the first whitespace (end of
+     * the genetic sequence).
+     * @param read A function (or lambda) that saves in buffer[0, size) the 
+     * codes of the next characters of the sequence, and returns the number 
+     * of saved codes. Input parameter
+     * @param length The maximum number of characters to read. If it is
+     * negative, the sequence is read until its end. Input parameter
+     * @param blockSize The number of characters read in each block. 
+     * Input parameter
+     * @param overlap See the previous methods. Input parameter
+     * @param counters The KmerCounters. Output parameter
+     * @return true if a whitespace was found; false otherwise
+     */
+    template <class Read>
+    static bool CountKmers(Read& read, long long length, int blockSize, 
+       long long overlap, const std::vector<BasicKmerCounter*>& counters);
+
+    /**
+     * @brief Obtains the code of the given kmer, that is, its position in the
+     * frequency matrix (row * getNumCols() + column)
+     * Query method
+     * @param kmer A Kmer. Input parameter
+     * @param code The code of @p kmer. Output parameter
+     * @return false if @p kmer does not have _k nucleotides of the set 
+     * _allNucleotides; true otherwise
+     */
+    bool getCode(const Kmer& kmer, unsigned long long& code) const;
+
+    /**
+     * @brief Fills the given table with the index in getCodeNucleotides() of
+     * the complement of each nucleotide of getCodeNucleotides() (see 
+     * setCanonical())
+     * Query method
+     * @param complement An array with getNumNucleotides() elements. 
+     * Output parameter
+     */
+    void getComplementCodes(unsigned char complement[]) const;
+
+    /**
+     * @brief Returns the Kmer that is defined by the given code
+     * Query method
+     * @param code The code of a kmer (see getCode()). Input parameter
+     * @return The Kmer that is defined by the given code
+     */
+    Kmer getKmer(unsigned long long code) const;
+
+    /**
+     * @brief Obtains the code and the frequency of the kmers of the hash 
+     * table with a frequency greater than 0, in increasing order of code
+     * Query method
+     * @return A vector of pairs (code, frequency)
+     */
+    std::vector<std::pair<unsigned long long, long long> > getSparseFrequencies() const;
+
+    /**
+     * @brief Obtains the code and the frequency of the kmers with a frequency
+     * greater than 0, in increasing order of code, from the hash table or
+     * the frequency matrix
+     * Query method
+     * @return A vector of pairs (code, frequency)
+     */
+    std::vector<std::pair<unsigned long long, long long> > getActiveFrequencies() const;
+
+    /**
+     * @brief Returns the frequency of the kmer with the given code, 
+     * including the part kept in _spill
+     * Query method
+     * @param code The code of a kmer (see getCode()). Input parameter
+     * @return The frequency of the kmer with the given code
+     */
+    long long getFrequency(unsigned long long code) const;
+
+    /**
+     * @brief Increases the frequency of the kmer with the given code. If the
+     * element of the frequency matrix reaches the maximum value of Cell, the
+     * rest is kept in _spill
+     * Modifier method
+     * @param code The code of a kmer (see getCode()). Input parameter
+     * @param frequency The quantity added to the frequency. Input parameter
+     */
+    void increaseCode(unsigned long long code, long long frequency);
+
     /**
      * @brief Obtains the row and column for the frequency of the given 
      * argument Kmer. -1 will be assigned to row or column if some of the
@@ -308,7 +717,7 @@ public:
      * @param column Column of the element. Input parameter
      * @return A const reference to the element at the given position
      */
-    const int& operator()(int row, int column) const;
+    const Cell& operator()(int row, int column) const;
 
     /**
      * @brief Overloading of the () operator to access to the element at a 
@@ -318,13 +727,23 @@ public:
      * @param column Column of the element. Input parameter
      * @return A reference to the element at the given position
      */
-    int& operator()(int row, int column);
+    Cell& operator()(int row, int column);
     
     void allocate(int rows, int colums);
     
     void deallocate();
     
-    void copy(const KmerCounter& kmerCounter);
+    void copy(const BasicKmerCounter& kmerCounter);
 };
 
+/**
+ * A BasicKmerCounter with elements of type int
+ */
+typedef BasicKmerCounter<int> KmerCounter;
+
+extern template class BasicKmerCounter<unsigned char>;
+extern template class BasicKmerCounter<unsigned short>;
+extern template class BasicKmerCounter<int>;
+extern template class BasicKmerCounter<long long>;
+
 #endif /* KMER_COUNTER_H */
@@ -45,7 +45,7 @@ public:
      * Query method
      * @return The frequency of this KmerFreq object
      */
-    int getFrequency() const;
+    long long getFrequency() const;
 
     /**
      * @brief Sets the Kmer of this KmerFreq object.
@@ -61,7 +61,7 @@ public:
      * @param frequency the new frequency value for this KmerFreq object. 
      * Input parameter
      */
-    void setFrequency(int frequency);
+    void setFrequency(long long frequency);
     
     /**
      * @brief Obtains a string with the string and frequency of the kmer
@@ -75,26 +75,34 @@ public:
     /**
      * @brief Writes this object to the given output stream. It first writes
      * the kmer of this object (using method Kmer::write(ostream&)) 
-     * and then the bytes of the frequency (an int value) in binary format 
+     * and then the bytes of the frequency (an int value, or a long long value
+     * if @p wideFrequency is true) in binary format 
      * (using method ostream::write(const char* s, streamsize n))
      * Query method
      * @param outputStream An output stream where this object will be written
+     * @param wideFrequency true to write the frequency as a long long value.
+     * Input parameter
+     * @throw std::out_of_range Throws a std::out_of_range if 
+     * @p wideFrequency is false and the frequency does not fit in an int
      */
-    void write(std::ostream& outputStream) const;
+    void write(std::ostream& outputStream, bool wideFrequency = false) const;
     
     /**
      * @brief Reads this object from the given input stream. It first reads
      * the Kmer of this object (using method Kmer::read(std::istream&) and 
-     * then the bytes of the frequency (an int value) in binary format (using 
+     * then the bytes of the frequency (an int value, or a long long value
+     * if @p wideFrequency is true) in binary format (using 
      * method istream::read(char* s, streamsize n))
      * Modifier method
      * @param inputStream An input stream from which this object will be read
+     * @param wideFrequency true to read the frequency as a long long value.
+     * Input parameter
      */
-    void read(std::istream& inputStream);
+    void read(std::istream& inputStream, bool wideFrequency = false);
     
 private:
     Kmer _kmer; ///< the Kmer object
-    int _frequency; ///< the frequency
+    long long _frequency; ///< the frequency
 }; // end class KmerFreq
 
 /**
@@ -0,0 +1,185 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file KmerHashTable.h
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#ifndef KMER_HASH_TABLE_H
+#define KMER_HASH_TABLE_H
+
+/**
+ * @class KmerHashTable
+ * @brief A hash table that associates a frequency (a long long) to the code
+ * of a kmer (an unsigned long long). It is used by KmerCounter to store only
+ * the kmers with a frequency greater than 0, when the number of possible 
+ * kmers is too big for a frequency matrix.
+ *
+ * It uses open addressing with linear probing: the keys and the values are
+ * stored in two arrays of _capacity elements (a power of two), and a key
+ * is placed in the first free slot from the position given by its hash.
+ * The free slots contain the key EMPTY_KEY. When the number of keys
+ * exceeds the maximum load factor (MAX_LOAD_PERCENT), the capacity of the
+ * arrays is doubled.
+ */
+class KmerHashTable {
+public:
+
+    /**
+     * Key of the free slots. It cannot be used as the code of a kmer
+     */
+    static const unsigned long long EMPTY_KEY = ~0ULL;
+
+    /**
+     * Default initial capacity (number of slots) of the table
+     */
+    static const long long INITIAL_CAPACITY = 1024;
+
+    /**
+     * Maximum percentage of used slots. When it is exceeded, the capacity
+     * of the table is doubled
+     */
+    static const int MAX_LOAD_PERCENT = 70;
+
+    /**
+     * @brief Constructor of the class. Builds an empty table
+     * @param capacity The initial number of slots. It is rounded up to a
+     * power of two. Input parameter
+     * @throw std::invalid_argument Throws a std::invalid_argument if
+     * @p capacity is less than 1
+     */
+    KmerHashTable(long long capacity = INITIAL_CAPACITY);
+
+    /**
+     * @brief Copy constructor
+     * @param orig the KmerHashTable object used as source for the copy.
+     * Input parameter
+     */
+    KmerHashTable(const KmerHashTable& orig);
+
+    /**
+     * @brief Destructor
+     */
+    ~KmerHashTable();
+
+    /**
+     * @brief Overloading of the assignment operator.
+     * Modifier method
+     * @param orig the KmerHashTable object used as source for the assignment.
+     * Input parameter
+     * @return A reference to this object
+     */
+    KmerHashTable& operator=(const KmerHashTable& orig);
+
+    /**
+     * @brief Returns the number of keys in the table
+     * Query method
+     * @return The number of keys in the table
+     */
+    long long getSize() const;
+
+    /**
+     * @brief Returns the number of slots of the table
+     * Query method
+     * @return The number of slots of the table
+     */
+    long long getCapacity() const;
+
+    /**
+     * @brief Returns the key at the given slot (EMPTY_KEY if it is free)
+     * Query method
+     * @param slot A slot, from 0 to getCapacity()-1. Input parameter
+     * @return The key at the given slot
+     */
+    unsigned long long getKey(long long slot) const;
+
+    /**
+     * @brief Returns the value at the given slot (0 if it is free)
+     * Query method
+     * @param slot A slot, from 0 to getCapacity()-1. Input parameter
+     * @return The value at the given slot
+     */
+    long long getValue(long long slot) const;
+
+    /**
+     * @brief Returns the value associated to the given key, or 0 if the key
+     * is not in the table
+     * Query method
+     * @param key A key. Input parameter
+     * @return The value associated to the given key
+     */
+    long long get(unsigned long long key) const;
+
+    /**
+     * @brief Increases the value associated to the given key. If the key
+     * is not in the table, it is inserted with value @p value.
+     * Modifier method
+     * @param key A key, different from EMPTY_KEY. Input parameter
+     * @param value The quantity added to the value of the key. Input parameter
+     */
+    void increase(unsigned long long key, long long value = 1);
+
+    /**
+     * @brief Increases the values of this table with the values of the
+     * given table, inserting the keys that are not in this table
+     * Modifier method
+     * @param table A KmerHashTable. Input parameter
+     */
+    void add(const KmerHashTable& table);
+
+    /**
+     * @brief Removes all the keys of the table. The capacity is not modified
+     * Modifier method
+     */
+    void clear();
+
+private:
+    unsigned long long* _keys; ///< Key of each slot (EMPTY_KEY if free)
+    long long* _values; ///< Value of each slot
+    long long _capacity; ///< Number of slots (a power of two)
+    long long _size; ///< Number of used slots
+
+    /**
+     * @brief Returns the slot that contains the given key or, if it is not
+     * in the table, the free slot where it would be inserted
+     * Query method
+     * @param key A key. Input parameter
+     * @return The slot for the given key
+     */
+    long long findSlot(unsigned long long key) const;
+
+    /**
+     * @brief Changes the number of slots of the table, inserting again all
+     * its keys
+     * Modifier method
+     * @param capacity The new number of slots (a power of two). Input parameter
+     */
+    void rehash(long long capacity);
+
+    /**
+     * @brief Allocates the arrays of the table with the given number of
+     * slots, all of them free
+     * Modifier method
+     * @param capacity The number of slots (a power of two). Input parameter
+     */
+    void allocate(long long capacity);
+
+    /**
+     * @brief Frees the memory of the arrays of the table
+     * Modifier method
+     */
+    void deallocate();
+
+    /**
+     * @brief Copies the given table into this one
+     * Modifier method
+     * @param table A KmerHashTable. Input parameter
+     */
+    void copy(const KmerHashTable& table);
+};
+
+#endif /* KMER_HASH_TABLE_H */
@@ -0,0 +1,73 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file MappedFile.h
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/**
+ * @class MappedFile
+ * @brief A read-only view of the whole content of a file, mapped in memory
+ * with mmap(). The characters of the file are read directly from the page
+ * cache of the operating system, without copying them to a buffer.
+ *
+ * Only regular files (not empty) can be mapped: if the file is a pipe or
+ * a terminal, or the system does not provide mmap(), the object is built
+ * without a mapping (see isMapped()) and the file should be read with a
+ * stream.
+ */
+class MappedFile {
+public:
+
+    /**
+     * @brief Constructor of the class. Maps the given file in memory,
+     * advising the system that it will be read sequentially. It does not
+     * throw an exception if the file can not be mapped
+     * @param fileName The name of the file. Input parameter
+     */
+    MappedFile(const char* fileName);
+
+    /**
+     * @brief Destructor. Unmaps the file
+     */
+    ~MappedFile();
+
+    /**
+     * @brief Checks if the file was mapped in memory
+     * Query method
+     * @return true if the file was mapped in memory; false otherwise
+     */
+    bool isMapped() const;
+
+    /**
+     * @brief Returns the characters of the file (nullptr if it was not
+     * mapped)
+     * Query method
+     * @return The characters of the file
+     */
+    const char* getData() const;
+
+    /**
+     * @brief Returns the number of characters of the file (0 if it was not
+     * mapped)
+     * Query method
+     * @return The number of characters of the file
+     */
+    long long getSize() const;
+
+private:
+    const char* _data; ///< Characters of the file (nullptr if not mapped)
+    long long _size; ///< Number of characters of the file
+
+    MappedFile(const MappedFile& orig) = delete;
+    MappedFile& operator=(const MappedFile& orig) = delete;
+};
+
+#endif /* MAPPED_FILE_H */
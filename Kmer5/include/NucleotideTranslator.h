@@ -0,0 +1,78 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file NucleotideTranslator.h
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#ifndef NUCLEOTIDE_TRANSLATOR_H
+#define NUCLEOTIDE_TRANSLATOR_H
+
+/**
+ * @class NucleotideTranslator
+ * @brief Translates a block of characters of a genetic sequence into the
+ * codes given by a translation table of 256 elements (one for each
+ * character, see KmerCounter::getNucleotideCodes()), in a single pass
+ * before counting its kmers.
+ *
+ * When the table only distinguishes a few letters (without case), the
+ * whitespaces and the rest of characters, the translation compares 16 or
+ * 32 characters at once with SIMD instructions (SSE2 or AVX2, when the
+ * processor supports them). Otherwise, each character is translated with
+ * the table.
+ */
+class NucleotideTranslator {
+public:
+
+    /**
+     * Number of characters of the translation table
+     */
+    static const int NUM_CHARACTERS = 256;
+
+    /**
+     * Maximum number of letters with their own code for a vectorized
+     * translation
+     */
+    static const int MAX_LETTERS = 16;
+
+    /**
+     * @brief Constructor of the class
+     * @param codes The translation table: the code of each character.
+     * Input parameter
+     */
+    NucleotideTranslator(const unsigned char codes[]);
+
+    /**
+     * @brief Checks if the translation uses SIMD instructions
+     * Query method
+     * @return true if the translation uses SIMD instructions; false otherwise
+     */
+    bool isVectorized() const;
+
+    /**
+     * @brief Translates the given characters into their codes.
+     * @p characters and @p translated may be the same array
+     * Query method
+     * @param characters An array of characters. Input parameter
+     * @param size The number of characters. Input parameter
+     * @param translated An array with @p size elements, where the code of
+     * each character is saved. Output parameter
+     */
+    void translate(const char* characters, long long size, unsigned char translated[]) const;
+
+private:
+    unsigned char _codes[NUM_CHARACTERS]; ///< Code of each character
+    bool _vectorized; ///< true if the translation uses SIMD instructions
+    bool _avx2; ///< true if the processor supports AVX2
+    unsigned char _spaceCode; ///< Code of the whitespaces
+    unsigned char _otherCode; ///< Code of the characters without own code
+    int _numLetters; ///< Number of letters with their own code
+    unsigned char _letters[MAX_LETTERS]; ///< Letters (lowercase) with own code
+    unsigned char _letterCodes[MAX_LETTERS]; ///< Code of each letter
+};
+
+#endif /* NUCLEOTIDE_TRANSLATOR_H */
@@ -0,0 +1,159 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file Parallel.h
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs function(t) for each t from 0 to @p numThreads-1, each one in
+ * a different thread, and waits until all of them have finished. The call
+ * with t=0 is run in the calling thread. If @p numThreads is less or equals
+ * to 1, then function(0) is just called. If a call throws an exception (or
+ * a thread cannot be created), the rest of threads are still waited for,
+ * and then the first exception is rethrown in the calling thread.
+ * @param numThreads The number of threads. Input parameter
+ * @param function A function (or lambda) that receives the index of the
+ * thread (an int). Input parameter
+ */
+template <class Function>
+void ParallelFor(int numThreads, Function function) {
+
+    if (numThreads <= 1) {
+        function(0);
+        return;
+    }
+
+    std::mutex mutex;
+    std::exception_ptr exception;
+    auto run = [&](int t) {
+        try {
+            function(t);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception)
+                exception = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(numThreads - 1);
+        for (int t = 1; t < numThreads; t++)
+            threads.emplace_back(run, t);
+        run(0);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!exception)
+            exception = std::current_exception();
+    }
+
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+/**
+ * @brief Obtains the first position of the part @p part when @p size
+ * elements are divided into @p numParts consecutive parts of (almost) the
+ * same size. The part @p part contains the positions from
+ * GetPartBegin(size, numParts, part) to
+ * GetPartBegin(size, numParts, part + 1) - 1.
+ * @param size The number of elements. Input parameter
+ * @param numParts The number of parts. Input parameter
+ * @param part The index of the part (from 0 to @p numParts). Input parameter
+ * @return The first position of the part @p part
+ */
+inline long long GetPartBegin(long long size, int numParts, int part) {
+
+    return size / numParts * part + size % numParts * part / numParts;
+}
+
+/**
+ * @brief Runs function(t, task) for each task from 0 to costs.size()-1 using
+ * @p numThreads threads, where t is the index (from 0 to @p numThreads-1) 
+ * of the thread that runs that task. The tasks are taken in decreasing
+ * order of cost: they are dealt to the queues of the threads in that order,
+ * each thread takes the tasks of its own queue from the front and, when its
+ * queue is empty, it steals the last task of the queue of another thread.
+ * If a task throws an exception, the remaining tasks are not started and
+ * the exception is rethrown in the calling thread when all the threads have
+ * finished.
+ * @param numThreads The number of threads. Input parameter
+ * @param costs The estimated cost of each task. Input parameter
+ * @param function A function (or lambda) that receives the index of the
+ * thread and the index of the task (two ints). Input parameter
+ */
+template <class Function>
+void ParallelForTasks(int numThreads, const std::vector<long long>& costs,
+        Function function) {
+
+    int numTasks = costs.size();
+    std::vector<int> order(numTasks);
+    for (int task = 0; task < numTasks; task++)
+        order[task] = task;
+    std::stable_sort(order.begin(), order.end(), [&](int task1, int task2) {
+        return costs[task1] > costs[task2];
+    });
+
+    std::vector<std::deque<int> > queues(numThreads);
+    for (int i = 0; i < numTasks; i++)
+        queues[i % numThreads].push_back(order[i]);
+
+    std::mutex mutex;
+    std::exception_ptr exception;
+    ParallelFor(numThreads, [&](int t) {
+        bool finished = false;
+        while (!finished) {
+            int task = -1;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!exception) {
+                    if (!queues[t].empty()) {
+                        task = queues[t].front();
+                        queues[t].pop_front();
+                    }
+                    for (int victim = 1; task < 0 && victim < numThreads; victim++) {
+                        std::deque<int>& queue = queues[(t + victim) % numThreads];
+                        if (!queue.empty()) {
+                            task = queue.back();
+                            queue.pop_back();
+                        }
+                    }
+                }
+            }
+
+            if (task < 0)
+                finished = true;
+            else {
+                try {
+                    function(t, task);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!exception)
+                        exception = std::current_exception();
+                }
+            }
+        }
+    });
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+#endif /* PARALLEL_H */
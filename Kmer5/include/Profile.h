@@ -18,6 +18,7 @@
 
 
 #include <iostream>
+#include <vector>
 #include "KmerFreq.h"
 
 /**
@@ -57,6 +58,13 @@ public:
      */
     Profile(const Profile& orig);
 
+    /**
+     * @brief Move constructor. It takes the vector of pairs of @p orig 
+     * without copying it, and leaves @p orig empty, with no capacity
+     * @param orig the Profile object used as source. Input/output parameter
+     */
+    Profile(Profile&& orig) noexcept;
+
     /**
      * @brief Destructor
      */
@@ -71,6 +79,16 @@ public:
      */
     Profile& operator=(const Profile& orig);
 
+    /**
+     * @brief Move assignment operator. It releases the vector of pairs of 
+     * this object and takes the one of @p orig without copying it. 
+     * @p orig is left empty, with no capacity.
+     * Modifier method
+     * @param orig the Profile object used as source. Input/output parameter
+     * @return A reference to this object
+     */
+    Profile& operator=(Profile&& orig) noexcept;
+
     /**
      * @brief Returns the identifier of this profile object.
      * Query method
@@ -121,6 +139,21 @@ public:
      * @return The capacity of the vector of KmerFreq objects
      */
     int getCapacity() const;
+
+    /**
+     * @brief Increases the capacity of the vector of KmerFreq objects to 
+     * @p capacity if it is smaller. The KmerFreq objects are kept.
+     * Modifier method
+     * @param capacity The minimum capacity. Input parameter
+     */
+    void reserve(int capacity);
+
+    /**
+     * @brief Reduces the capacity of the vector of KmerFreq objects to 
+     * its size. The KmerFreq objects are kept.
+     * Modifier method
+     */
+    void shrinkToFit();
     
     /**
      * @brief Gets the distance between this Profile object (\f$P_1\f$) and 
@@ -142,6 +175,11 @@ public:
      * \f$rank_{kmer_i(P_1)}^{P_2}\f$, if the kmer \f$kmer_i(P_1)\f$ 
      * does not appears in the Profile \f$P_2\f$ we consider that the rank
      * is equals to the size of Profile \f$P_2\f$. 
+     * 
+     * If @p otherProfile has a rank table (see buildIndex()), the rank of 
+     * each kmer is obtained with a lookup in that table. Otherwise, each
+     * kmer is searched with findKmer(). The index and the rank table of 
+     * @p otherProfile are built here if they are not built yet.
      * Query method
      * @param otherProfile A Profile object. Input parameter
      * @pre The list of kmers of this and otherProfile should be ordered in 
@@ -174,6 +212,12 @@ public:
      * Profile. If found, it returns the position where it was found. If not,
      * it returns -1. We consider that position 0 is the first kmer in the 
      * list of kmers and this->getSize()-1 the last kmer.
+     * The search uses a hash table with the position of each kmer, which is
+     * built in the first search (in linear time) and kept up to date by 
+     * append(). The methods that can change the kmers or their positions 
+     * (the non-const at() and operator[], sort(), deletePos(), ...) discard
+     * it, so it is built again in the next search. A kmer changed through a
+     * reference obtained before the search is not detected.
      * Query method
      * @param kmer A kmer. Input parameter
      * @return If found, it returns the position where the kmer 
@@ -181,6 +225,17 @@ public:
      */
     int findKmer(const Kmer &kmer) const;
 
+    /**
+     * @brief Builds the hash table used by findKmer(), with the position of
+     * the first occurrence of each kmer, and the rank table used by 
+     * getDistance() when this Profile is its argument (see buildRankTable()).
+     * A Profile searched from several threads at once (for example, with 
+     * getDistance()) must be indexed before, since the first search would 
+     * build them in each thread.
+     * Query method
+     */
+    void buildIndex() const;
+
     /**
      * @brief Obtains a string with the following content:
      * - In the first line, the profile identifier of this Profile
@@ -198,9 +253,16 @@ public:
      * If two KmerFreq objects have the same frequency, then the alphabetical 
      * order of the kmers of those objects will be considered (the object 
      * with a kmer that comes first alphabetically will appear first).
+     * The KmerFreq objects with the same kmer and frequency keep their 
+     * order. If all the kmers have the same length, they are sorted in
+     * linear time with a radix sort of their frequencies and codes (see 
+     * RadixSortByFrequency()), using @p numThreads threads for large 
+     * profiles; otherwise, with a stable sort that compares their strings.
      * Modifier method
+     * @param numThreads The number of threads used by the radix sort.
+     * Input parameter
      */
-    void sort();
+    void sort(int numThreads = 1);
 
     /**
      * @brief Saves this Profile object in the given file. 
@@ -208,14 +270,22 @@ public:
      * @param fileName A c-string with the name of the file where this Profile 
      * object will be saved. Input parameter
      * @param mode The mode to use to save this Profile object: 't' for text
-     * mode and 'b' for binary mode. Input parameter
+     * mode and 'b' for binary mode. In binary mode, if all the kmers have
+     * the same length (at most 64) and their codes fit in 64 bits, the packed format
+     * (MAGIC_STRING_B_PACKED, see savePacked()) is used. Otherwise, each kmer
+     * is saved as a string and the frequencies are saved as int values 
+     * (MAGIC_STRING_B), unless some frequency does not fit in an int; in 
+     * that case they are saved as long long values (MAGIC_STRING_B_WIDE).
+     * Input parameter
+     * @param numThreads The number of threads used to format the pairs in
+     * text mode (see formatText()). Input parameter
      * @throw std::invalid_argument Throws a std::invalid_argument exception
      * if the given @mode is not valid ('t' or 'b')
      * @throw std::ios_base::failure Throws a std::ios_base::failure exception 
      * if the given file cannot be opened or if an error occurs while writing
      * to the file
      */
-    void save(const char fileName[], char mode = 't') const;
+    void save(const char fileName[], char mode = 't', int numThreads = 1) const;
 
     /**
      * @brief Loads into this object the Profile object stored in the given 
@@ -230,7 +300,8 @@ public:
      * if the given file cannot be opened or if an error occurs while reading
      * from the file
      * @throw throw std::invalid_argument Throws a std::invalid_argument if
-     * an invalid magic string is found in the given file
+     * an invalid magic string is found in the given file, or if a file in
+     * the packed binary format is truncated or corrupted
      */
     void load(const char fileName[]);
      
@@ -275,6 +346,9 @@ CT 4
 CT 9
 _G 5
      * 
+     * The repeated kmers are merged in a single pass, searching each kmer in
+     * a hash table of the previous ones (see findKmer()), and the vector is
+     * compacted keeping the order of the first occurrences.
      * Modifier method
      * @param validNucleotides a string with the list of characters (nucleotides) 
      * that should be considered as valid. Input parameter
@@ -309,8 +383,16 @@ _G 5
      * KmerFreq objects with a frequency less or equals to this value, are 
      * deleted. This parameter has zero as default value.
      * Input parameter
+     * The kept objects are compacted in a single pass, keeping their order.
+     * If @p numThreads is greater than 1, the vector is divided into 
+     * consecutive parts that are filtered in different threads, and each
+     * part is copied after the objects kept in the previous ones. If less
+     * than half of the capacity is used at the end, the excess capacity is
+     * released.
+     * @param numThreads The number of threads used for large profiles.
+     * Input parameter
      */
-    void zip(bool deleteMissing=false, int lowerBound = 0);
+    void zip(bool deleteMissing=false, int lowerBound = 0, int numThreads = 1);
     
     /**
      * @brief Appends to this Profile object, the list of pairs  
@@ -376,19 +458,172 @@ _G 5
     void deallocate();
     
     void reallocate(int capacity);
+
+    /**
+     * @brief Increases the capacity of the vector of KmerFreq objects, if
+     * needed, to have room for @p size objects. The capacity is at least
+     * doubled, so that appending n objects takes O(n) time
+     * @param size The number of objects. Input parameter
+     */
+    void grow(int size);
     
     void copy(const Profile& profile);
+
+    /**
+     * @brief Obtains the code of each kmer of this Profile: the number in 
+     * base b formed by its nucleotides, where b is the number of different
+     * nucleotides and each nucleotide is numbered in alphabetical order. So,
+     * the order of the codes is the order of the kmers
+     * @param alphabet The different nucleotides, in alphabetical order.
+     * Output parameter
+     * @param codes The code of each kmer. Output parameter
+     * @return false if the kmers have different lengths or the codes do not
+     * fit in an unsigned long long; true otherwise
+     */
+    bool packKmers(std::string& alphabet, std::vector<unsigned long long>& codes) const;
+
+    /**
+     * @brief Saves this Profile in the packed binary format. After the magic 
+     * string line (MAGIC_STRING_B_PACKED), the file is formed by sections
+     * that start at a multiple of 8 bytes:
+     *  -# A header (PackedHeader) with the number of kmers, k (at most 
+     * 64), the size of the alphabet and of the identifier, some flags 
+     * with the byte order and a checksum
+     *  -# The alphabet (the nucleotides in alphabetical order) and the 
+     * profile identifier
+     *  -# The code of each kmer (see packKmers()), as unsigned long long
+     *  -# The frequency of each kmer, as long long
+     * 
+     * The numbers are saved in the byte order of this machine, and a file
+     * saved with the other byte order is rejected by loadPacked().
+     * @param outputStream The output stream. Output parameter
+     * @param alphabet The nucleotides of the kmers, in alphabetical order.
+     * Input parameter
+     * @param codes The code of each kmer. Input parameter
+     */
+    void savePacked(std::ostream& outputStream, const std::string& alphabet,
+        const std::vector<unsigned long long>& codes) const;
+
+    /**
+     * @brief Loads into this object the Profile saved in the packed binary
+     * format (see savePacked()). The columns of codes and frequencies are
+     * copied as they are, without parsing them, and then the repeated kmers
+     * are merged (see mergeRepeated()), as in the rest of formats
+     * @param data The content of the file, after the magic string line.
+     * Input parameter
+     * @param size The number of bytes of @p data. Input parameter
+     * @throw std::invalid_argument Throws a std::invalid_argument exception
+     * if the data is truncated, it was saved with another byte order, its 
+     * header or some kmer code is not valid, or its checksum is not valid
+     */
+    void loadPacked(const char* data, long long size);
+
+    /**
+     * @brief Loads into this object the Profile saved in text format, after
+     * the magic string line: the identifier line, the number of kmers and
+     * each kmer followed by its frequency, separated by whitespaces. The
+     * pairs are put directly in the vector, and then the repeated kmers are
+     * merged (see mergeRepeated())
+     * @param data The content of the file, after the magic string line.
+     * Input parameter
+     * @param size The number of bytes of @p data. Input parameter
+     * @throw std::out_of_range Throws a std::out_of_range exception if the 
+     * number of kmers is negative
+     * @throw std::ios_base::failure Throws a std::ios_base::failure exception 
+     * if a number is not valid or some pair is missing
+     */
+    void loadText(const char* data, long long size);
+
+    /**
+     * @brief Merges the repeated kmers in a single pass: the frequency of 
+     * each repeated kmer is added to its first occurrence, and the rest of
+     * kmers are moved forward, keeping their order. At the end, the index
+     * (_index) is built
+     */
+    void mergeRepeated();
+
+    /**
+     * @brief Writes the pairs of this Profile in text format, each one in a
+     * new line, as operator<<(). The pairs are formatted in blocks of
+     * WRITE_BLOCK_SIZE pairs into reused strings, and each block is written 
+     * at once. If @p numThreads is greater than 1, several blocks are 
+     * formatted in parallel and then written in order
+     * @param outputStream The output stream. Output parameter
+     * @param numThreads The number of threads. Input parameter
+     */
+    void formatText(std::ostream& outputStream, int numThreads = 1) const;
+
+    /**
+     * @brief Returns the slot of the index (_index) with the position of the
+     * given kmer, or the empty slot where it would be saved
+     * @param kmer A kmer. Input parameter
+     * @return A slot of _index
+     */
+    size_t findSlot(const Kmer& kmer) const;
+
+    /**
+     * @brief Makes the index (_index) empty, with room for the given number
+     * of kmers
+     * @param numKmers The number of kmers. Input parameter
+     */
+    void clearIndex(int numKmers) const;
+
+    /**
+     * @brief Builds the rank table (_ranks) if all the kmers have the same
+     * length and the number of their possible codes is not greater than 
+     * RANK_TABLE_FACTOR times the number of kmers (nor MAX_RANK_TABLE_SIZE).
+     * Otherwise, it is left empty and getDistance() uses the hash index
+     */
+    void buildRankTable() const;
+
+    /**
+     * @brief Adds to the index (_index), if it is built, the kmer at the 
+     * given position, which must be the last one and not be repeated
+     * @param pos The position of the kmer. Input parameter
+     */
+    void addToIndex(int pos);
+
+    /**
+     * @brief Discards the index (_index), so that it is built again in the
+     * next search
+     */
+    void invalidateIndex();
     
     std::string _profileId; ///< Profile identifier
     KmerFreq* _vectorKmerFreq; ///< Dynamic array of KmerFreq
     int _size; ///< Number of used elements in the dynamic array _vectorKmerFreq
     int _capacity; ///< Number of reserved elements in the dynamic array _vectorKmerFreq
 
+    /**
+     * Hash table with open addressing (linear probing) with the position of
+     * each kmer in _vectorKmerFreq, or -1 in the empty slots. Its capacity is
+     * a power of two. It is empty if it is not built
+     */
+    mutable std::vector<int> _index;
+    mutable int _indexSize; ///< Number of kmers in _index
+
+    /**
+     * Position of the first occurrence of each kmer, indexed by its code: 
+     * the number formed by its nucleotides, with the digits given by
+     * _rankAlphabet. The codes of the kmers that are not in this Profile 
+     * have its size. It is empty if it is not built or it would be too big
+     */
+    mutable std::vector<int> _ranks;
+    mutable std::string _rankAlphabet; ///< Nucleotides of the digits of the codes of _ranks
+    mutable int _ranksSize; ///< Number of kmers when _ranks was built, or -1
+
     static const int INITIAL_CAPACITY=10; ///< Default initial capacity for the dynamic array _vectorKmerFreq. Should be a number >= 0
-    static const int BLOCK_SIZE=20; ///< Size of new blocks in the dynamic array _vectorKmerFreq 
+    static const int BLOCK_SIZE=20; ///< Minimum increment of the capacity of the dynamic array _vectorKmerFreq when it grows
+    static const int MIN_INDEX_CAPACITY=16; ///< Minimum capacity of the hash table _index
+    static const int MAX_RANK_TABLE_SIZE=1 << 24; ///< Maximum number of elements of the rank table _ranks
+    static const int RANK_TABLE_FACTOR=8; ///< Maximum number of elements of the rank table _ranks for each kmer
+    static const int MIN_ZIP_ELEMENTS_PER_THREAD=1 << 16; ///< Minimum number of elements filtered by each thread in zip()
+    static const int WRITE_BLOCK_SIZE=1 << 16; ///< Number of pairs formatted at once by formatText()
 
     static const std::string MAGIC_STRING_T; ///< A const string with the magic string for text files
     static const std::string MAGIC_STRING_B; ///< A const string with the magic string for binary files
+    static const std::string MAGIC_STRING_B_WIDE; ///< A const string with the magic string for binary files with long long frequencies
+    static const std::string MAGIC_STRING_B_PACKED; ///< A const string with the magic string for binary files with packed kmers
 };
 
 /**
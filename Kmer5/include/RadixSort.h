@@ -0,0 +1,121 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file RadixSort.h
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <algorithm>
+#include <vector>
+
+#include "Parallel.h"
+
+/**
+ * Minimum number of elements sorted by each thread in SortByByte()
+ */
+const long long MIN_RADIX_ELEMENTS_PER_THREAD = 1 << 16;
+
+/**
+ * @brief Sorts the given elements in a stable way by one byte of the value
+ * given by key(element), with a counting sort. The elements are divided
+ * into @p numThreads consecutive parts, and each part is counted and moved
+ * in a different thread. If all the elements have the same byte, they are
+ * not moved.
+ * @param elements The elements. Input/output parameter
+ * @param buffer A vector with the same size as @p elements.
+ * Output parameter
+ * @param key A function (or lambda) that returns the value of an element
+ * (an unsigned long long). Input parameter
+ * @param shift The position of the byte in the value (in bits).
+ * Input parameter
+ * @param numThreads The number of threads. Input parameter
+ */
+template <class Element, class Key>
+void SortByByte(std::vector<Element>& elements, std::vector<Element>& buffer,
+        Key key, int shift, int numThreads) {
+
+    const int NUM_BUCKETS = 256;
+    long long size = elements.size();
+    std::vector<std::vector<long long> > positions(numThreads, std::vector<long long>(NUM_BUCKETS, 0));
+    ParallelFor(numThreads, [&](int t) {
+        long long last = GetPartBegin(size, numThreads, t + 1);
+        for (long long i = GetPartBegin(size, numThreads, t); i < last; i++)
+            positions[t][(key(elements[i]) >> shift) & (NUM_BUCKETS - 1)]++;
+    });
+
+    // The elements of each part go after the ones of the previous parts
+    // with the same byte
+    long long position = 0;
+    for (int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+        long long count = 0;
+        for (int t = 0; t < numThreads; t++)
+            count += positions[t][bucket];
+        if (count == size)
+            return;
+        for (int t = 0; t < numThreads; t++) {
+            long long partCount = positions[t][bucket];
+            positions[t][bucket] = position;
+            position += partCount;
+        }
+    }
+
+    ParallelFor(numThreads, [&](int t) {
+        long long last = GetPartBegin(size, numThreads, t + 1);
+        for (long long i = GetPartBegin(size, numThreads, t); i < last; i++)
+            buffer[positions[t][(key(elements[i]) >> shift) & (NUM_BUCKETS - 1)]++] = elements[i];
+    });
+    elements.swap(buffer);
+}
+
+/**
+ * @brief Sorts the given elements by decreasing frequency and, for the same
+ * frequency, by increasing code, with a LSD radix sort: the elements are
+ * sorted in a stable way by each byte of the code and then by each byte of
+ * the frequency, from the least significant one. Only the bytes used by
+ * the greatest code and frequency are taken into account, so it takes
+ * linear time. The elements with the same code and frequency keep their
+ * order.
+ * @param elements The elements. Input/output parameter
+ * @param code A function (or lambda) that returns the code of an element
+ * (an unsigned long long). Input parameter
+ * @param frequency A function (or lambda) that returns the frequency of an
+ * element (a long long, not negative). Input parameter
+ * @param numThreads The number of threads used to sort large vectors
+ * (see SortByByte()). Input parameter
+ */
+template <class Element, class Code, class Frequency>
+void RadixSortByFrequency(std::vector<Element>& elements, Code code,
+        Frequency frequency, int numThreads = 1) {
+
+    unsigned long long maxCode = 0;
+    long long maxFrequency = 0;
+    for (size_t i = 0; i < elements.size(); i++) {
+        maxCode = std::max(maxCode, static_cast<unsigned long long>(code(elements[i])));
+        maxFrequency = std::max(maxFrequency, static_cast<long long>(frequency(elements[i])));
+    }
+
+    numThreads = std::max(1LL, std::min(static_cast<long long>(numThreads),
+            static_cast<long long>(elements.size()) / MIN_RADIX_ELEMENTS_PER_THREAD));
+    std::vector<Element> buffer(elements.size());
+    auto codeKey = [&code](const Element& element) {
+        return static_cast<unsigned long long>(code(element));
+    };
+    for (int shift = 0; shift < 64 && (maxCode >> shift) > 0; shift += 8)
+        SortByByte(elements, buffer, codeKey, shift, numThreads);
+
+    // The greatest frequency gets the smallest value
+    auto frequencyKey = [&frequency, maxFrequency](const Element& element) {
+        return static_cast<unsigned long long>(maxFrequency - frequency(element));
+    };
+    for (int shift = 0; shift < 64 && (static_cast<unsigned long long>(maxFrequency) >> shift) > 0; shift += 8)
+        SortByByte(elements, buffer, frequencyKey, shift, numThreads);
+}
+
+#endif /* RADIX_SORT_H */
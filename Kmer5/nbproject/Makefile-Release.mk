@@ -38,6 +38,9 @@ OBJECTFILES= \
 	${OBJECTDIR}/src/Kmer.o \
 	${OBJECTDIR}/src/KmerCounter.o \
 	${OBJECTDIR}/src/KmerFreq.o \
+	${OBJECTDIR}/src/KmerHashTable.o \
+	${OBJECTDIR}/src/MappedFile.o \
+	${OBJECTDIR}/src/NucleotideTranslator.o \
 	${OBJECTDIR}/src/Profile.o \
 	${OBJECTDIR}/src/metamain.o
 
@@ -56,7 +59,7 @@ FFLAGS=
 ASFLAGS=
 
 # Link Libraries and Options
-LDLIBSOPTIONS=
+LDLIBSOPTIONS=-pthread
 
 # Build Targets
 .build-conf: ${BUILD_SUBPROJECTS}
@@ -81,6 +84,21 @@ ${OBJECTDIR}/src/KmerFreq.o: src/KmerFreq.cpp
 	${RM} "$@.d"
 	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/KmerFreq.o src/KmerFreq.cpp
 
+${OBJECTDIR}/src/KmerHashTable.o: src/KmerHashTable.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/KmerHashTable.o src/KmerHashTable.cpp
+
+${OBJECTDIR}/src/MappedFile.o: src/MappedFile.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/MappedFile.o src/MappedFile.cpp
+
+${OBJECTDIR}/src/NucleotideTranslator.o: src/NucleotideTranslator.cpp
+	${MKDIR} -p ${OBJECTDIR}/src
+	${RM} "$@.d"
+	$(COMPILE.cc) -O2 -MMD -MP -MF "$@.d" -o ${OBJECTDIR}/src/NucleotideTranslator.o src/NucleotideTranslator.cpp
+
 ${OBJECTDIR}/src/Profile.o: src/Profile.cpp
 	${MKDIR} -p ${OBJECTDIR}/src
 	${RM} "$@.d"
@@ -3,9 +3,17 @@
  * Curso 2023/2024
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
 
 #include "KmerCounter.h"
+#include "Parallel.h"
 
 /** 
  * @file CLASSIFY.cpp
@@ -25,24 +33,65 @@
 void showEnglishHelp(std::ostream& outputStream) {
     outputStream << "ERROR in CLASSIFY parameters" << std::endl;
     outputStream << "Run with the following parameters:" << std::endl;
-    outputStream << "CLASSIFY [-k kValue] [-n nucleotidesSet] <file.dna> <profile1.prf> [<profile2.prf> <profile3.prf> ....]" << std::endl;
+    outputStream << "CLASSIFY [-k kValue] [-n nucleotidesSet] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] <file.dna> <profile1.prf> [<profile2.prf> <profile3.prf> ....]" << std::endl;
+    outputStream << "CLASSIFY [-k kValue] [-n nucleotidesSet] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] -q queriesFile <profile1.prf> [<profile2.prf> <profile3.prf> ....]" << std::endl;
     outputStream << std::endl;
     outputStream << "Parameters:" << std::endl;
     outputStream << "-k kValue: number of nucleotides in a kmer (5 by default)" << std::endl;
     outputStream << "-n nucletiodesSet: set of possible nucleotides in a kmer (ACGT by default). "
             << "It is used when learning a model for <file.dna>. "
             << "Note that the characters should be provided in uppercase" << std::endl;
+    outputStream << "-s blockSize: number of characters read from <file.dna> in each block ("
+            << KmerCounter::DEFAULT_BLOCK_SIZE << " by default)" << std::endl;
+    outputStream << "-j numThreads: number of threads used to count the kmers of <file.dna>, or to classify the files of queriesFile (1 by default)" << std::endl;
+    outputStream << "-c: canonical mode, each kmer of <file.dna> is counted together with its reverse complement. "
+            << "The profile models should be learned in canonical mode" << std::endl;
+    outputStream << "-w counterWidth: number of bits (8, 16, 32 or 64) of each counter of kmers (32 by default). "
+            << "A greater frequency is kept apart, so it only changes the memory used" << std::endl;
+    outputStream << "-q queriesFile: batch mode, each DNA file listed in queriesFile (one name per line) is classified instead of <file.dna>. "
+            << "The profile models are loaded once, and a line with the closest profile is printed for each file, in the order of queriesFile" << std::endl;
     outputStream << "<profile1.prf> [<profile2.prf> <profile3.prf> ....] ....: "
             << "names of the Profile models (at least one is mandatory)" << std::endl;
     outputStream << std::endl;
-    outputStream << "This program obtains the identifier of the closest profile to the input DNA file" << std::endl;
+    outputStream << "This program obtains the identifier of the closest profile to the input DNA file (or to each input DNA file in batch mode)" << std::endl;
     outputStream << std::endl;
 }
 
-int PosMinMax(const Profile& profile, const Profile* profiles, int n_input_profiles, bool (*Compare)(double n1, double n2)) {
+/**
+ * Obtains a positive integer from the value of a parameter
+ * @param text The value of the parameter
+ * @param value The integer. Output parameter
+ * @return true if @p text is a positive integer that fits in an int; false 
+ * otherwise
+ */
+bool ParsePositiveInt(const char* text, int& value) {
+
+    char* end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || number < 1 || number > INT_MAX)
+        return false;
+    value = number;
+
+    return true;
+}
+
+/**
+ * Obtains the profile model with the minimum (or maximum) distance to the 
+ * given Profile
+ * @param profile A Profile
+ * @param profiles The profile models
+ * @param n_input_profiles The number of profile models
+ * @param Compare Minimum() or Maximum()
+ * @param min_max_distance The distance to the profile model found. Output 
+ * parameter
+ * @return The position of the profile model found
+ */
+int PosMinMax(const Profile& profile, const Profile* profiles, int n_input_profiles, 
+        bool (*Compare)(double n1, double n2), double& min_max_distance) {
 
     int pos_min_max = 0;
-    double min_max_distance = profile.getDistance(profiles[0]);
+    min_max_distance = profile.getDistance(profiles[0]);
     for (int i = 1; i < n_input_profiles; i++) {
         double distance = profile.getDistance(profiles[i]);
         if (Compare(min_max_distance, distance)) {
@@ -64,24 +113,177 @@ bool Maximum(double n1, double n2) {
     return n1 < n2;
 }
 
+/**
+ * Obtains the Profile of an input DNA file, using a BasicKmerCounter with
+ * counters of type Cell. The kmers with any missing nucleotide are skipped
+ * while counting, so the Profile does not need to be zipped
+ * @param fileName The name of the input file
+ * @param kValue The number of nucleotides in a kmer
+ * @param nucleotidesSet The set of valid nucleotides
+ * @param canonical true to count the kmers in canonical mode
+ * @param blockSize The number of characters read in each block
+ * @param numThreads The number of threads used to count the kmers
+ * @return The Profile of the input file, sorted by decreasing frequency
+ */
+template <class Cell>
+Profile CountProfile(const char* fileName, int kValue,
+        const std::string& nucleotidesSet, bool canonical, int blockSize,
+        int numThreads) {
+
+    BasicKmerCounter<Cell> kmerCounter(kValue, nucleotidesSet,
+            BasicKmerCounter<Cell>::IsSparseBetter(kValue, nucleotidesSet, true), true);
+    kmerCounter.setCanonical(canonical);
+    kmerCounter.calculateFrequencies(fileName, blockSize, numThreads);
+
+    return kmerCounter.toSortedProfile();
+}
+
+/**
+ * Obtains the Profile of an input DNA file (see CountProfile()), using 
+ * counters of the given number of bits
+ * @param fileName The name of the input file
+ * @param counterWidth The number of bits of each counter (8, 16, 32 or 64)
+ * @param kValue The number of nucleotides in a kmer
+ * @param nucleotidesSet The set of valid nucleotides
+ * @param canonical true to count the kmers in canonical mode
+ * @param blockSize The number of characters read in each block
+ * @param numThreads The number of threads used to count the kmers
+ * @return The Profile of the input file, sorted by decreasing frequency
+ * @throw std::invalid_argument Throws a std::invalid_argument exception if 
+ * @p counterWidth is not valid
+ */
+Profile CountProfile(const char* fileName, int counterWidth, int kValue,
+        const std::string& nucleotidesSet, bool canonical, int blockSize,
+        int numThreads) {
+
+    switch (counterWidth) {
+        case 8:
+            return CountProfile<unsigned char>(fileName, kValue, nucleotidesSet,
+                    canonical, blockSize, numThreads);
+
+        case 16:
+            return CountProfile<unsigned short>(fileName, kValue, nucleotidesSet,
+                    canonical, blockSize, numThreads);
+
+        case 32:
+            return CountProfile<int>(fileName, kValue, nucleotidesSet,
+                    canonical, blockSize, numThreads);
+
+        case 64:
+            return CountProfile<long long>(fileName, kValue, nucleotidesSet,
+                    canonical, blockSize, numThreads);
+
+        default:
+            throw std::invalid_argument("Profile CountProfile(const char* fileName, int counterWidth, int kValue, const std::string& nucleotidesSet, bool canonical, int blockSize, int numThreads): the counter width is not valid");
+    }
+}
+
+/**
+ * Reads the names of the files of a batch of queries: a name in each line.
+ * The empty lines are skipped
+ * @param fileName The name of the file with the queries
+ * @param queries The names of the files. Output parameter
+ * @return false if the file cannot be opened; true otherwise
+ */
+bool ReadQueries(const char* fileName, std::vector<std::string>& queries) {
+
+    std::ifstream input(fileName);
+    if (!input)
+        return false;
+
+    std::string line;
+    while (getline(input, line))
+        if (!line.empty())
+            queries.push_back(line);
+
+    return true;
+}
+
+/**
+ * Classifies each file of a batch of queries: its Profile is obtained and
+ * compared with the profile models, and a line with the closest one is 
+ * printed for each file, in the order of @p queries. The queries are 
+ * distributed among the threads, and the threads that are not needed for 
+ * that count each file by ranges. If a file cannot be opened, or it cannot
+ * be classified (for example, it has no kmers), a line 
+ * "ERROR classifying <file.dna>: cannot be opened" (or "cannot be 
+ * classified") is printed in std::cerr instead, and the rest of files are
+ * classified
+ * @param queries The names of the DNA files
+ * @param profiles The profile models, already indexed (see 
+ * Profile::buildIndex())
+ * @param n_input_profiles The number of profile models
+ * @param counterWidth The number of bits of each counter
+ * @param kValue The number of nucleotides in a kmer
+ * @param nucleotidesSet The set of valid nucleotides
+ * @param canonical true to count the kmers in canonical mode
+ * @param blockSize The number of characters read in each block
+ * @param numThreads The number of threads
+ * @return true if all the files were classified; false otherwise
+ */
+bool ClassifyQueries(const std::vector<std::string>& queries, const Profile* profiles,
+        int n_input_profiles, int counterWidth, int kValue, 
+        const std::string& nucleotidesSet, bool canonical, int blockSize,
+        int numThreads) {
+
+    int numQueries = queries.size();
+    int numWorkers = std::max(1, std::min(numThreads, numQueries));
+    int numQueryThreads = std::max(1, numThreads / numWorkers);
+    std::vector<int> closest(numQueries);
+    std::vector<double> distances(numQueries);
+    std::vector<std::string> errors(numQueries);
+    ParallelForTasks(numWorkers, std::vector<long long>(numQueries, 1), [&](int worker, int query) {
+        if (!std::ifstream(queries[query].c_str()))
+            errors[query] = "cannot be opened";
+        else {
+            try {
+                Profile profile = CountProfile(queries[query].c_str(), counterWidth, kValue,
+                        nucleotidesSet, canonical, blockSize, numQueryThreads);
+                closest[query] = PosMinMax(profile, profiles, n_input_profiles, Minimum,
+                        distances[query]);
+            } catch (const std::exception&) {
+                errors[query] = "cannot be classified";
+            }
+        }
+    });
+
+    bool classified = true;
+    for (int i = 0; i < numQueries; i++) {
+        if (errors[i].empty())
+            std::cout << queries[i] << ": " << profiles[closest[i]].getProfileId() 
+                    << " with a distance of " << distances[i] << std::endl;
+        else {
+            std::cerr << "ERROR classifying " << queries[i] << ": " << errors[i] << std::endl;
+            classified = false;
+        }
+    }
+
+    return classified;
+}
+
 /**
  * This program prints the profile identifier of the closest profile model
  * for an input DNA file (<file.dna>) among the set of provided models:
  * <profile1.prf>, <profile2.prf>, ...
  * The program uses the KmerCounter class to obtain a Profile for the input
- * file <file.dna>. That Profile should be zipped, to eliminate kmers with
- * any missing nucleotide, and sorted in decreasing order of frequency of
- * kmers. After that, the program compares the learned Profile with the ones
+ * file <file.dna>, skipping the kmers with any missing nucleotide. That
+ * Profile is sorted in decreasing order of frequency of kmers. After that,
+ * the program compares the learned Profile with the ones
  * provided by the arguments <profile1.prf> [<profile2.prf> <profile3.prf> ....]
  * It classifies the input DNA file with the identifier of the Profile with
  * a minor distance.
+ * In batch mode (-q queriesFile), the profile models are loaded once and 
+ * each DNA file listed in queriesFile is classified in the same way, in
+ * parallel. A line "<file.dna>: <identifier> with a distance of <distance>"
+ * is printed for each file, in the order of queriesFile.
  * 
  * This program assumes that the profile files are already normalized and 
  * sorted by frequency. This is not checked in this program. Unexpected results
  * will be obtained if those conditions are not met.
  * 
  * Running sintax:
- * > CLASSIFY [-k kValue] [-n nucleotidesSet] <file.dna> <profile1.prf> [<profile2.prf> <profile3.prf> ....]
+ * > CLASSIFY [-k kValue] [-n nucleotidesSet] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] <file.dna> <profile1.prf> [<profile2.prf> <profile3.prf> ....]
+ * > CLASSIFY [-k kValue] [-n nucleotidesSet] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] -q queriesFile <profile1.prf> [<profile2.prf> <profile3.prf> ....]
  * 
  * Running example: 
  * > CLASSIFY ../Genomes/human_chr6_s60000_l500000.dna ../Genomes/brewers_yeast_chrVII.s1_l500000.prf ../Genomes/chimpanzee_chr9_s1_l500000.prf ../Genomes/covidFullGenomeDNA.prf ../Genomes/drosophila_chr2L_s1_l500000.prf ../Genomes/ebolaFullGenomeDNA.prf ../Genomes/human_chr9_s10000_l500000.prf ../Genomes/monkeypoxFullGenomeDNA.prf ../Genomes/mouse_chr6_s3050050_l500000.prf ../Genomes/nematode_chrI_s1l500000.prf ../Genomes/rat_chr6_s1l500000.prf ../Genomes/zebrafish_chr6_s1l500000.prf
@@ -112,6 +314,11 @@ int main(int argc, char *argv[]) {
     
     int kValue = 5;
     std::string nucleotidesSet = "ACGT";
+    int blockSize = KmerCounter::DEFAULT_BLOCK_SIZE;
+    int numThreads = 1;
+    bool canonical = false;
+    int counterWidth = 32;
+    std::string queriesFile;
     bool continues = true;
     int pos = 1;
     while (pos < argc && continues) {
@@ -119,10 +326,8 @@ int main(int argc, char *argv[]) {
             if (strlen(argv[pos]) == 2) {
                 switch(argv[pos][1]) {
                     case 'k':
-                        if (pos + 1 < argc) {
-                            kValue = atoi(argv[pos + 1]);
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], kValue))
                             pos += 2;
-                        }
                         
                         else {
                             showEnglishHelp(std::cerr);
@@ -144,6 +349,57 @@ int main(int argc, char *argv[]) {
                         
                         break;
                         
+                    case 's':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], blockSize))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
+                    case 'j':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], numThreads))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
+                    case 'c':
+                        canonical = true;
+                        pos++;
+                        break;
+
+                    case 'q':
+                        if (pos + 1 < argc) {
+                            queriesFile = argv[pos + 1];
+                            pos += 2;
+                        }
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
+                    case 'w':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], counterWidth))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+                        
                     default:
                         showEnglishHelp(std::cerr);
                         return 1;
@@ -161,19 +417,44 @@ int main(int argc, char *argv[]) {
             continues = false;
     }
 
-    // Calculate the kmer frecuencies of the input genome file using a KmerCounter object
-    KmerCounter kmerCounter(kValue, nucleotidesSet);
-    kmerCounter.calculateFrequencies(argv[pos]);
-    pos++;
+    if (counterWidth != 8 && counterWidth != 16 && counterWidth != 32 && counterWidth != 64) {
+        showEnglishHelp(std::cerr);
+        return 1;
+    }
 
-    // Obtain a Profile object for the input genome from the KmerCounter object
-    Profile profile = kmerCounter.toProfile();
-    
-    // Zip the for the input genome Profile object
-    profile.zip(true);
+    // In batch mode, the profile models are loaded and indexed once, and 
+    // then each file of queriesFile is classified
+    if (!queriesFile.empty()) {
+        std::vector<std::string> queries;
+        if (pos >= argc || !ReadQueries(queriesFile.c_str(), queries)) {
+            showEnglishHelp(std::cerr);
+            return 1;
+        }
+
+        int n_input_profiles = argc - pos;
+        Profile* profiles = new Profile[n_input_profiles];
+        for (int i = 0; i < n_input_profiles; i++) {
+            profiles[i].load(argv[pos + i]);
+            profiles[i].buildIndex();
+        }
+        bool classified = ClassifyQueries(queries, profiles, n_input_profiles, 
+                counterWidth, kValue, nucleotidesSet, canonical, blockSize, numThreads);
+        delete[] profiles;
+
+        return classified ? 0 : 1;
+    }
 
-    // Sort the for the input genome Profile object
-    profile.sort();
+    // Obtain a sorted Profile object for the input genome, counting its kmers with
+    // counters of counterWidth bits
+    Profile profile;
+    try {
+        profile = CountProfile(argv[pos], counterWidth, kValue, 
+                nucleotidesSet, canonical, blockSize, numThreads);
+    } catch (const std::exception& exception) {
+        std::cerr << "ERROR in CLASSIFY: " << exception.what() << std::endl;
+        return 1;
+    }
+    pos++;
 
     // Use a loop to print the distance from the input genome to each one of the provided profile models
     int n_input_profiles = argc - pos;
@@ -185,8 +466,9 @@ int main(int argc, char *argv[]) {
         std::cout << "Distance to " << argv[pos + i] << " (" << profiles[i].getProfileId() << ")" << ": " << profile.getDistance(profiles[i]) << std::endl;
 
     // Print the identifier and distance to the closest profile
-    int pos_min = PosMinMax(profile, profiles, n_input_profiles, Minimum);
-    std::cout << std::endl << "Final decision: " << profiles[pos_min].getProfileId() << " with a distance of " << profile.getDistance(profiles[pos_min]) << std::endl;
+    double min_distance;
+    int pos_min = PosMinMax(profile, profiles, n_input_profiles, Minimum, min_distance);
+    std::cout << std::endl << "Final decision: " << profiles[pos_min].getProfileId() << " with a distance of " << min_distance << std::endl;
 
     delete[] profiles;
 
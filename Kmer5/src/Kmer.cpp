@@ -41,7 +41,7 @@ int Kmer::size() const {
     return getK();
 }
 
-std::string Kmer::toString() const {
+const std::string& Kmer::toString() const {
 
     return _text;
 }
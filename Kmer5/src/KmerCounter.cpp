@@ -13,71 +13,480 @@
  * Created on 22 December 2023, 10:00
  */
 
-#include <complex>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
 
 #include "KmerCounter.h"
+#include "MappedFile.h"
+#include "NucleotideTranslator.h"
+#include "Parallel.h"
+#include "RadixSort.h"
 
 /**
  * DEFAULT_VALID_NUCLEOTIDES is a c-string that contains the set of characters
  * that will be considered as valid nucleotides. 
 
- * The constructor of the class KmerCounter uses this c-string as a 
+ * The constructor of the class BasicKmerCounter uses this c-string as a 
  * default parameter. It is possible to use a different c-string if that
  * constructor is used with a different c-string
  */
-const char* const KmerCounter::DEFAULT_VALID_NUCLEOTIDES = "ACGT";
+template <class Cell>
+const char* const BasicKmerCounter<Cell>::DEFAULT_VALID_NUCLEOTIDES = "ACGT";
 
-KmerCounter::KmerCounter(int k, const std::string& validNucleotides) : _k(k), _validNucleotides(validNucleotides),
-_allNucleotides(Kmer::MISSING_NUCLEOTIDE + validNucleotides) {
+/**
+ * Maximum value of k with a specialized KmerEncoder
+ */
+static const int MAX_FIXED_K = 16;
+
+/**
+ * @brief Returns @p base raised to @p exponent
+ * @param base The base
+ * @param exponent The exponent
+ * @return base^exponent (1 if @p exponent is not positive)
+ */
+static constexpr unsigned long long Power(unsigned long long base, int exponent) {
+
+    return exponent <= 0 ? 1 : base * Power(base, exponent - 1);
+}
+
+/**
+ * @brief Rolling encoder of the kmers of a genetic sequence. It receives the
+ * codes of the nucleotides of the sequence (see NucleotideTranslator) in 
+ * consecutive ranges and calls increase(code)
+ * with the code of each kmer found. It stops at the first whitespace 
+ * (SEQUENCE_END). The kmers with an INVALID_NUCLEOTIDE are skipped: the next
+ * kmer starts after it.
+ * 
+ * The code of each kmer is the number in base @p base formed by its 
+ * nucleotides, so the code of the next kmer is obtained removing the first
+ * nucleotide and appending the new one. The code of the reverse complement
+ * has the complement of the first nucleotide as its last digit, so it is
+ * updated dividing by base and adding the complement of the new nucleotide
+ * as the first digit
+ * 
+ * The template parameters K and BASE give k and the base at compile time,
+ * so the weights are constants and the multiplications and divisions by the
+ * base are replaced by shifts when it is a power of two. With base 4, the
+ * first nucleotide is removed with a mask. KmerEncoder<0, 0> takes both
+ * values from the constructor.
+ */
+template <int K, int BASE>
+class KmerEncoder {
+public:
+
+    /**
+     * @brief Constructor of the class
+     * @param complement The table given by KmerCounter::getComplementCodes()
+     * to count each kmer with the smaller of its code and the code of its
+     * reverse complement, or nullptr to count each kmer with its code. 
+     * Input parameter
+     * @param k The number of nucleotides in each kmer. It must be K if K is
+     * not 0. Input parameter
+     * @param base The number of nucleotides (including the missing one). It
+     * must be BASE if BASE is not 0. Input parameter
+     */
+    KmerEncoder(const unsigned char complement[], int k, 
+            unsigned long long base) : _complement(complement), _k(k), 
+            _base(base), _firstWeight(Power(base, k - 1)),
+            _code(0), _reverseCode(0), _reverseWeight(1), _numNucleotides(0) {
+    }
+
+    /**
+     * @brief Encodes the kmers that end in the nucleotides 
+     * nucleotides[begin, end). The k codes before @p begin must be the
+     * previous nucleotides of the sequence, if they are part of the current
+     * kmer
+     * @param nucleotides The codes of the nucleotides of the sequence. 
+     * Input parameter
+     * @param begin The position of the first character. Input parameter
+     * @param end The position after the last character. Input parameter
+     * @param increase A function (or lambda) that receives the code of a
+     * kmer. Input parameter
+     * @return true if a whitespace was found; false otherwise
+     */
+    template <class Increase>
+    bool encode(const unsigned char* nucleotides, long long begin, long long end, Increase& increase) {
+
+        const int k = getK();
+        const unsigned long long base = getBase();
+        for (long long i = begin; i < end; i++) {
+            unsigned char nucleotide = nucleotides[i];
+            if (nucleotide == KmerCounter::SEQUENCE_END)
+                return true;
+            else if (nucleotide == KmerCounter::INVALID_NUCLEOTIDE) {
+                _code = 0;
+                _reverseCode = 0;
+                _reverseWeight = 1;
+                _numNucleotides = 0;
+            }
+            else {
+                if (BASE == 4 && K != 0)
+                    _code = ((_code << 2) | nucleotide) & MASK;
+                else {
+                    if (_numNucleotides >= k)
+                        _code -= nucleotides[i - k] * getFirstWeight();
+                    _code = _code * base + nucleotide;
+                }
+                _numNucleotides++;
+                if (_complement == nullptr) {
+                    if (_numNucleotides >= k)
+                        increase(_code);
+                }
+                else {
+                    if (_numNucleotides > k)
+                        _reverseCode /= base;
+                    _reverseCode += _complement[nucleotide] * _reverseWeight;
+                    if (_numNucleotides < k)
+                        _reverseWeight *= base;
+                    else
+                        increase(std::min(_code, _reverseCode));
+                }
+            }
+        }
+
+        return false;
+    }
+
+private:
+    /**
+     * Weight of the first nucleotide of a kmer, when K and BASE are known
+     */
+    static const unsigned long long FIXED_FIRST_WEIGHT = Power(BASE, K > 0 ? K - 1 : 0);
+
+    /**
+     * Mask of the 2*K bits of a code in base 4
+     */
+    static const unsigned long long MASK = Power(4, K) - 1;
+
+    const unsigned char* _complement; ///< Code of the complement of each code
+    int _k; ///< Number of nucleotides in each kmer
+    unsigned long long _base; ///< Number of nucleotides
+    unsigned long long _firstWeight; ///< Weight of the first nucleotide
+    unsigned long long _code; ///< Code of the current kmer
+    unsigned long long _reverseCode; ///< Code of its reverse complement
+    unsigned long long _reverseWeight; ///< Weight of the next complement
+    long long _numNucleotides; ///< Nucleotides since the last invalid one
+
+    int getK() const {
+        return K != 0 ? K : _k;
+    }
+
+    unsigned long long getBase() const {
+        return BASE != 0 ? BASE : _base;
+    }
+
+    unsigned long long getFirstWeight() const {
+        return K != 0 && BASE != 0 ? FIXED_FIRST_WEIGHT : _firstWeight;
+    }
+};
 
-    allocate(getNumRows(), getNumCols());
+/**
+ * Function that encodes the kmers that end in nucleotides[begin, end) with
+ * a KmerEncoder (see KmerEncoder::encode())
+ */
+typedef std::function<bool(const unsigned char* nucleotides, long long begin, long long end)> EncodeFunction;
+
+/**
+ * Number of nucleotides passed to each EncodeFunction in turn, so that they
+ * are still in the cache when the next function encodes them
+ */
+static const int CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief Template of the loop that counts the kmers of a genetic sequence.
+ * It obtains the codes of at most @p length characters with the function 
+ * read(buffer, size), in blocks of @p blockSize characters, and passes them 
+ * to each of the given encode functions, in chunks of CHUNK_SIZE codes.
+ * @param read A function (or lambda) that saves in buffer[0, size) the 
+ * codes of the next characters of the sequence, and returns the number of
+ * saved codes (less than size at the end of the sequence). Input parameter
+ * @param length The maximum number of characters to read. If it is
+ * negative, the sequence is read until its end. Input parameter
+ * @param blockSize The number of characters read in each block.
+ * Input parameter
+ * @param maxK The greatest number of nucleotides in a kmer of the encode 
+ * functions. Input parameter
+ * @param encoders The encode functions. Input/output parameter
+ * @param skips The number of characters at the start of the sequence that
+ * are not passed to each encode function. Input parameter
+ * @return true if a whitespace was found; false otherwise
+ */
+template <class Read>
+static bool EncodeSequence(Read& read, long long length, int blockSize, int maxK, 
+        std::vector<EncodeFunction>& encoders, std::vector<long long> skips) {
+
+    // Each block is saved after the last maxK codes of the previous one
+    // (carry): the last k-1 are the first nucleotides of the kmers that cross
+    // the boundary between both blocks, and the one before them is the 
+    // nucleotide removed from the code when moving to the first of those kmers
+    unsigned char* buffer = new unsigned char[maxK + blockSize];
+    int carry = 0;
+    bool finished = false, ended = false;
+    while (!finished && !ended && length != 0) {
+        int size = blockSize;
+        if (length >= 0 && length < size)
+            size = length;
+        int numRead = read(buffer + carry, size);
+        ended = numRead < size;
+        int end = carry + numRead;
+        if (length >= 0)
+            length -= numRead;
+
+        for (int first = carry; first < end && !finished; first += CHUNK_SIZE) {
+            int last = std::min(first + CHUNK_SIZE, end);
+            for (size_t i = 0; i < encoders.size(); i++) {
+                long long skip = std::min(skips[i], static_cast<long long>(last - first));
+                skips[i] -= skip;
+                if (encoders[i](buffer, first + skip, last))
+                    finished = true;
+            }
+        }
+
+        carry = std::min(end, maxK);
+        std::copy(buffer + end - carry, buffer + end, buffer);
+    }
+
+    delete[] buffer;
+
+    return finished;
+}
+
+/**
+ * @brief Builds an EncodeFunction with the given encoder and increase 
+ * function
+ * @param encoder A KmerEncoder. Input parameter
+ * @param increase A function (or lambda) that receives the code of a kmer.
+ * Input parameter
+ * @return The EncodeFunction
+ */
+template <class Encoder, class Increase>
+static EncodeFunction MakeEncodeFunction(Encoder encoder, Increase increase) {
+
+    return [encoder, increase](const unsigned char* nucleotides, long long begin, long long end) mutable {
+        return encoder.encode(nucleotides, begin, end, increase);
+    };
+}
+
+template <int K>
+struct KmerEncoderDispatch;
+
+/**
+ * @brief Uses the generic KmerEncoder (see KmerEncoderDispatch)
+ */
+template <>
+struct KmerEncoderDispatch<MAX_FIXED_K + 1> {
+
+    template <class Increase>
+    static EncodeFunction make(int k, unsigned long long base, 
+            const unsigned char complement[], const Increase& increase) {
+
+        return MakeEncodeFunction(KmerEncoder<0, 0>(complement, k, base), increase);
+    }
+};
+
+/**
+ * @brief Chooses the KmerEncoder specialized for the given k and base (base
+ * 4 or 5 and k from K to MAX_FIXED_K), or the generic one otherwise
+ */
+template <int K>
+struct KmerEncoderDispatch {
+
+    /**
+     * @brief Builds an EncodeFunction with the KmerEncoder for the given k
+     * and base
+     * @param k The number of nucleotides in each kmer. Input parameter
+     * @param base The number of nucleotides. Input parameter
+     * @param complement See KmerEncoder. Input parameter
+     * @param increase A function (or lambda) that receives the code of a 
+     * kmer. Input parameter
+     * @return The EncodeFunction
+     */
+    template <class Increase>
+    static EncodeFunction make(int k, unsigned long long base, 
+            const unsigned char complement[], const Increase& increase) {
+
+        if (k != K)
+            return KmerEncoderDispatch<K + 1>::make(k, base, complement, increase);
+        else if (base == 4)
+            return MakeEncodeFunction(KmerEncoder<K, 4>(complement, k, base), increase);
+        else if (base == 5)
+            return MakeEncodeFunction(KmerEncoder<K, 5>(complement, k, base), increase);
+        else
+            return KmerEncoderDispatch<MAX_FIXED_K + 1>::make(k, base, complement, increase);
+    }
+};
+
+/**
+ * @brief Increases the frequency of a kmer in a KmerHashTable
+ */
+struct SparseIncrease {
+    KmerHashTable& table; ///< Frequency of each kmer
+
+    void operator()(unsigned long long code) {
+        table.increase(code);
+    }
+};
+
+/**
+ * @brief Increases the frequency of a kmer in a frequency matrix. An element
+ * of the matrix that reaches the maximum value of Cell keeps the rest of the
+ * frequency in a KmerHashTable
+ */
+template <class Cell>
+struct DenseIncrease {
+    Cell* frequency; ///< Frequency of each kmer (matrix stored by rows)
+    KmerHashTable& spill; ///< Frequency that does not fit in the matrix
+
+    void operator()(unsigned long long code) {
+        if (frequency[code] != std::numeric_limits<Cell>::max())
+            frequency[code]++;
+        else
+            spill.increase(code);
+    }
+};
+
+template <class Cell>
+BasicKmerCounter<Cell>::BasicKmerCounter(int k, const std::string& validNucleotides, bool sparse, bool skipMissing) : _k(k), _validNucleotides(validNucleotides),
+_allNucleotides(Kmer::MISSING_NUCLEOTIDE + validNucleotides), _sparse(sparse), _table(1),
+_spill(1), _canonical(false), _skipMissing(skipMissing) {
+
+    if (k < 1)
+        throw std::invalid_argument("KmerCounter::KmerCounter(int k, const std::string& validNucleotides, bool sparse, bool skipMissing): k is less than 1");
+    if (_sparse) {
+        if (GetNumCodes(k, validNucleotides, skipMissing) == 0)
+            throw std::invalid_argument("KmerCounter::KmerCounter(int k, const std::string& validNucleotides, bool sparse, bool skipMissing): the codes of the kmers do not fit in an unsigned long long");
+        _frequency = nullptr;
+        _table = KmerHashTable();
+    }
+    else
+        allocate(getNumRows(), getNumCols());
     initFrequencies();
 }
 
-KmerCounter::KmerCounter(const KmerCounter& orig) {
+template <class Cell>
+BasicKmerCounter<Cell>::BasicKmerCounter(const BasicKmerCounter& orig) : _frequency(nullptr), _table(1), _spill(1) {
 
-    allocate(orig.getNumRows(), orig.getNumCols());
     copy(orig);
 }
 
-KmerCounter::~KmerCounter() {
+template <class Cell>
+bool BasicKmerCounter<Cell>::IsSparseBetter(int k, const std::string& validNucleotides, bool skipMissing) {
+
+    unsigned long long numCodes = GetNumCodes(k, validNucleotides, skipMissing);
+
+    // The limit of the frequency matrix is given for elements of type int
+    return numCodes == 0 || numCodes > MAX_DENSE_KMERS * sizeof(int) / sizeof(Cell);
+}
+
+template <class Cell>
+unsigned long long BasicKmerCounter<Cell>::GetNumCodes(int k, const std::string& validNucleotides, bool skipMissing) {
+
+    unsigned long long base = validNucleotides.size() + (skipMissing ? 0 : 1), numCodes = 1;
+    for (int i = 0; i < k; i++) {
+        if (numCodes > (KmerHashTable::EMPTY_KEY - 1) / base)
+            return 0;
+        numCodes *= base;
+    }
+
+    return numCodes;
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::isSparse() const {
+
+    return _sparse;
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::isCanonical() const {
+
+    return _canonical;
+}
+
+template <class Cell>
+void BasicKmerCounter<Cell>::setCanonical(bool canonical) {
+
+    _canonical = canonical;
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::isSkippingMissing() const {
+
+    return _skipMissing;
+}
+
+template <class Cell>
+BasicKmerCounter<Cell>::~BasicKmerCounter() {
 
     deallocate();
 }
 
-int KmerCounter::getNumNucleotides() const {
+template <class Cell>
+int BasicKmerCounter<Cell>::getNumNucleotides() const {
 
     return _allNucleotides.size();
 }
 
-int KmerCounter::getK() const {
+template <class Cell>
+const std::string& BasicKmerCounter<Cell>::getCodeNucleotides() const {
+
+    return _skipMissing ? _validNucleotides : _allNucleotides;
+}
+
+template <class Cell>
+int BasicKmerCounter<Cell>::getK() const {
 
     return _k;
 }
 
-int KmerCounter::getNumKmers() const {
+template <class Cell>
+long long BasicKmerCounter<Cell>::getNumKmers() const {
+
+    long long numKmers = 1;
+    for (int i = 0; i < getK(); i++)
+        numKmers *= getCodeNucleotides().size();
 
-    return std::pow(getNumNucleotides(), getK());
+    return numKmers;
 }
 
-int KmerCounter::getNumberActiveKmers() const {
+template <class Cell>
+int BasicKmerCounter<Cell>::getNumberActiveKmers() const {
 
     int actives = 0, rows = getNumRows(), cols = getNumCols();
+    if (_sparse) {
+        for (long long slot = 0; slot < _table.getCapacity(); slot++)
+            if (_table.getValue(slot) > 0)
+                actives++;
+    }
+
     for (int r = 0; r < rows; r++)
         for (int c = 0; c < cols; c++)
-            if (this->operator()(r, c) > 0)
+            if (getFrequency(static_cast<unsigned long long>(r) * cols + c) > 0)
                 actives++;
 
     return actives;
 }
 
-std::string KmerCounter::toString() const {
+template <class Cell>
+std::string BasicKmerCounter<Cell>::toString() const {
     std::string outputString = _allNucleotides + " " + std::to_string(_k) + "\n";
 
+    if (_sparse) {
+        std::vector<std::pair<unsigned long long, long long> > frequencies = getSparseFrequencies();
+        for (size_t i = 0; i < frequencies.size(); i++)
+            outputString += getKmer(frequencies[i].first).toString() + " " + 
+                    std::to_string(frequencies[i].second) + "\n";
+    }
+
+    int cols = getNumCols();
     for (int row = 0; row<this->getNumRows(); row++) {
-        for (int col = 0; col<this->getNumCols(); col++) {
-            outputString += std::to_string((*this)(row, col)) + " ";
+        for (int col = 0; col<cols; col++) {
+            outputString += std::to_string(getFrequency(static_cast<unsigned long long>(row) * cols + col)) + " ";
         }
         outputString += "\n";
     }
@@ -85,18 +494,27 @@ std::string KmerCounter::toString() const {
     return outputString;
 }
 
-void KmerCounter::increaseFrequency(const Kmer& kmer, int frequency) {
+template <class Cell>
+void BasicKmerCounter<Cell>::increaseFrequency(const Kmer& kmer, long long frequency) {
     
     if (kmer.toString().find_first_not_of(_allNucleotides) != std::string::npos)
-        throw std::invalid_argument("void KmerCounter::increaseFrequency(const Kmer& kmer, int frequency): the given kmer contains an invalid nucleotide.");
+        throw std::invalid_argument("void KmerCounter::increaseFrequency(const Kmer& kmer, long long frequency): the given kmer contains an invalid nucleotide.");
 
-    int row, column;
-    getRowColumn(kmer, row, column);
-    if (row != -1 && column != -1)
-        this->operator()(row, column) += frequency;
+    if (_sparse) {
+        unsigned long long code;
+        if (getCode(kmer, code))
+            _table.increase(code, frequency);
+    }
+    else {
+        int row, column;
+        getRowColumn(kmer, row, column);
+        if (row != -1 && column != -1)
+            increaseCode(static_cast<unsigned long long>(row) * getNumCols() + column, frequency);
+    }
 }
 
-KmerCounter& KmerCounter::operator=(const KmerCounter& orig) {
+template <class Cell>
+BasicKmerCounter<Cell>& BasicKmerCounter<Cell>::operator=(const BasicKmerCounter& orig) {
 
     if (&orig != this)
         copy(orig);
@@ -104,7 +522,8 @@ KmerCounter& KmerCounter::operator=(const KmerCounter& orig) {
     return *this;
 }
 
-KmerCounter& KmerCounter::operator+=(const KmerCounter& kc) {
+template <class Cell>
+BasicKmerCounter<Cell>& BasicKmerCounter<Cell>::operator+=(const BasicKmerCounter& kc) {
 
     if (kc.getK() != getK())
         throw std::invalid_argument("KmerCounter& KmerCounter::operator+=(const KmerCounter& kc): kc has a different k");
@@ -112,88 +531,380 @@ KmerCounter& KmerCounter::operator+=(const KmerCounter& kc) {
     if (kc._allNucleotides != _allNucleotides)
         throw std::invalid_argument("KmerCounter& KmerCounter::operator+=(const KmerCounter& kc): kc has a different set of nucleotides");
 
-    int row = getNumRows(), cols = getNumCols();
-    for (int r = 0; r < row; r++)
-        for (int c = 0; c < cols; c++)
-            this->operator()(r, c) += kc(r, c);
+    if (kc._skipMissing != _skipMissing)
+        throw std::invalid_argument("KmerCounter& KmerCounter::operator+=(const KmerCounter& kc): kc has a different way of counting missing nucleotides");
 
-    return *this;
+    return add(kc);
 }
 
-void KmerCounter::calculateFrequencies(const char* fileName) {
+template <class Cell>
+BasicKmerCounter<Cell>& BasicKmerCounter<Cell>::add(const BasicKmerCounter& kc, int numThreads) {
+
+    if (kc.getK() != getK())
+        throw std::invalid_argument("KmerCounter& KmerCounter::add(const KmerCounter& kc, int numThreads): kc has a different k");
+
+    if (kc._allNucleotides != _allNucleotides)
+        throw std::invalid_argument("KmerCounter& KmerCounter::add(const KmerCounter& kc, int numThreads): kc has a different set of nucleotides");
+
+    if (kc._skipMissing != _skipMissing)
+        throw std::invalid_argument("KmerCounter& KmerCounter::add(const KmerCounter& kc, int numThreads): kc has a different way of counting missing nucleotides");
+
+    if (numThreads < 1)
+        throw std::invalid_argument("KmerCounter& KmerCounter::add(const KmerCounter& kc, int numThreads): numThreads is less than 1");
 
-    std::ifstream input(fileName);
-    if (!input) {
-        input.close();
-        throw std::ios_base::failure("void KmerCounter::calculateFrequencies(const char* fileName): fileName can not be opened");
+    // The code of a kmer is its index in the frequency matrix (row * 
+    // getNumCols() + column), so both storages are combined by codes
+    if (_sparse && kc._sparse)
+        _table.add(kc._table);
+    else if (_sparse) {
+        long long size = kc.getNumKmers();
+        const Cell* kcFrequency = kc._frequency[0];
+        for (long long i = 0; i < size; i++)
+            if (kcFrequency[i] != 0)
+                _table.increase(i, kc.getFrequency(i));
     }
-    
+    else if (kc._sparse) {
+        for (long long slot = 0; slot < kc._table.getCapacity(); slot++)
+            if (kc._table.getKey(slot) != KmerHashTable::EMPTY_KEY)
+                increaseCode(kc._table.getKey(slot), kc._table.getValue(slot));
+    }
+    else {
+        // Each thread saves the part of the sums that does not fit in the
+        // matrix, and it is added to _spill after joining the threads
+        long long size = getNumKmers();
+        Cell* frequency = _frequency[0];
+        const Cell* kcFrequency = kc._frequency[0];
+        const Cell maxCell = std::numeric_limits<Cell>::max();
+        std::vector<std::vector<std::pair<unsigned long long, long long> > > overflows(numThreads);
+        ParallelFor(numThreads, [&](int t) {
+            long long last = GetPartBegin(size, numThreads, t + 1);
+            for (long long i = GetPartBegin(size, numThreads, t); i < last; i++) {
+                Cell room = maxCell - frequency[i];
+                if (kcFrequency[i] <= room)
+                    frequency[i] += kcFrequency[i];
+                else {
+                    overflows[t].push_back(std::make_pair(i, static_cast<long long>(kcFrequency[i] - room)));
+                    frequency[i] = maxCell;
+                }
+            }
+        });
+
+        for (int t = 0; t < numThreads; t++)
+            for (size_t i = 0; i < overflows[t].size(); i++)
+                _spill.increase(overflows[t][i].first, overflows[t][i].second);
+        _spill.add(kc._spill);
+    }
+
+    return *this;
+}
+
+template <class Cell>
+void BasicKmerCounter<Cell>::calculateFrequencies(const char* fileName, int blockSize, int numThreads) {
+
     initFrequencies();
-    std::string inputString;
-    input >> inputString;
-    int k = getK();
-    int kmers = inputString.size() - k + 1;
-    for (int i = 0; i < kmers; i++) {
-        Kmer kmer(inputString.substr(i, k));
-        kmer.normalize(_validNucleotides);
-        increaseFrequency(kmer);
-    } 
+    addFrequencies(fileName, blockSize, numThreads);
 }
 
-Profile KmerCounter::toProfile() const {
+template <class Cell>
+void BasicKmerCounter<Cell>::addFrequencies(const char* fileName, int blockSize, int numThreads) {
 
-    Profile profile;
-    KmerFreq kmerFreq;
-    int rows = getNumRows(), cols = getNumCols();
-    for (int r = 0; r < rows; r++)
-        for (int c = 0; c < cols; c++) {
-            if (this->operator()(r, c) > 0) {
-                kmerFreq.setFrequency(this->operator()(r, c));
-                kmerFreq.setKmer(getKmer(r, c));
-                profile.append(kmerFreq);
+    AddFrequencies(std::vector<BasicKmerCounter*>(1, this), fileName, blockSize, numThreads);
+}
+
+template <class Cell>
+void BasicKmerCounter<Cell>::AddFrequencies(const std::vector<BasicKmerCounter*>& counters,
+        const char* fileName, int blockSize, int numThreads) {
+
+    if (blockSize < 1)
+        throw std::invalid_argument("void KmerCounter::AddFrequencies(const std::vector<BasicKmerCounter*>& counters, const char* fileName, int blockSize, int numThreads): blockSize is less than 1");
+
+    if (numThreads < 1)
+        throw std::invalid_argument("void KmerCounter::AddFrequencies(const std::vector<BasicKmerCounter*>& counters, const char* fileName, int blockSize, int numThreads): numThreads is less than 1");
+
+    for (size_t i = 1; i < counters.size(); i++)
+        if (counters[i]->_validNucleotides != counters[0]->_validNucleotides ||
+                counters[i]->_skipMissing != counters[0]->_skipMissing)
+            throw std::invalid_argument("void KmerCounter::AddFrequencies(const std::vector<BasicKmerCounter*>& counters, const char* fileName, int blockSize, int numThreads): the counters have different sets of nucleotides or ways of counting missing nucleotides");
+
+    if (counters.empty())
+        return;
+
+    unsigned char codes[NUM_CHARACTERS];
+    counters[0]->getNucleotideCodes(codes);
+
+    // Map the file in memory if it is possible; otherwise it is read with
+    // a stream. In both cases, the whitespaces before the genetic sequence
+    // are skipped, and the number of characters from the start of the 
+    // sequence to the end of the file is obtained (if it is needed)
+    MappedFile mappedFile(fileName);
+    const char* data = mappedFile.getData();
+    std::ifstream input;
+    long long begin = -1, length = -1;
+    if (mappedFile.isMapped()) {
+        begin = 0;
+        while (begin < mappedFile.getSize() && codes[static_cast<unsigned char>(data[begin])] == SEQUENCE_END)
+            begin++;
+        if (begin == mappedFile.getSize())
+            return;
+        length = mappedFile.getSize() - begin;
+    }
+    else {
+        input.open(fileName);
+        if (!input) {
+            input.close();
+            throw std::ios_base::failure("void KmerCounter::AddFrequencies(const std::vector<BasicKmerCounter*>& counters, const char* fileName, int blockSize, int numThreads): fileName can not be opened");
+        }
+
+        int character = input.get();
+        while (character != std::char_traits<char>::eof() && codes[character] == SEQUENCE_END)
+            character = input.get();
+        if (character == std::char_traits<char>::eof())
+            return;
+        input.unget();
+
+        if (numThreads > 1) {
+            begin = input.tellg();
+            if (begin >= 0 && input.seekg(0, std::ios_base::end)) {
+                length = static_cast<long long>(input.tellg()) - begin;
+                input.seekg(begin);
             }
+            input.clear();
         }
+    }
+
+    if (numThreads > 1 && length < numThreads)
+        numThreads = length > 1 ? length : 1;
+
+    if (numThreads == 1) {
+        if (mappedFile.isMapped())
+            CountKmers(data + begin, length, codes, blockSize, 0, counters);
+        else
+            CountKmers(input, -1, codes, blockSize, 0, counters);
+        return;
+    }
+    input.close();
+
+    // Each thread t counts the kmers that end in its range of characters 
+    // [first, last), so it starts reading maxK-1 characters before first. 
+    // The thread 0 uses the given counters and the other ones thread-local
+    // BasicKmerCounters. Only the threads before the first one that 
+    // finds the end of the sequence (a whitespace) are taken into account
+    int maxK = 0;
+    std::vector<BasicKmerCounter> counterShards;
+    for (size_t i = 0; i < counters.size(); i++) {
+        maxK = std::max(maxK, counters[i]->getK());
+        counterShards.push_back(BasicKmerCounter(counters[i]->getK(), counters[i]->_validNucleotides,
+                counters[i]->_sparse, counters[i]->_skipMissing));
+        counterShards.back().setCanonical(counters[i]->_canonical);
+    }
+    std::vector<std::vector<BasicKmerCounter> > shards(numThreads - 1, counterShards);
+    std::vector<char> finished(numThreads, false), failed(numThreads, false);
+    ParallelFor(numThreads, [&](int t) {
+        long long first = GetPartBegin(length, numThreads, t);
+        long long last = GetPartBegin(length, numThreads, t + 1);
+        long long start = std::max(first - (maxK - 1), 0LL);
+        std::vector<BasicKmerCounter*> threadCounters(counters);
+        if (t > 0)
+            for (size_t i = 0; i < counters.size(); i++)
+                threadCounters[i] = &shards[t - 1][i];
+        if (mappedFile.isMapped())
+            finished[t] = CountKmers(data + begin + start, last - start, codes, blockSize, first - start, threadCounters);
+        else {
+            std::ifstream rangeInput(fileName);
+            if (!rangeInput.seekg(begin + start))
+                failed[t] = true;
+            else
+                finished[t] = CountKmers(rangeInput, last - start, codes, blockSize, first - start, threadCounters);
+        }
+    });
+
+    if (std::find(failed.begin(), failed.end(), true) != failed.end())
+        throw std::ios_base::failure("void KmerCounter::AddFrequencies(const std::vector<BasicKmerCounter*>& counters, const char* fileName, int blockSize, int numThreads): fileName can not be read");
+
+    int lastThread = std::find(finished.begin(), finished.end(), true) - finished.begin();
+    for (int t = 1; t < numThreads && t <= lastThread; t++)
+        for (size_t i = 0; i < counters.size(); i++)
+            counters[i]->add(shards[t - 1][i], numThreads);
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::CountKmers(std::istream& input, long long length,
+        const unsigned char codes[], int blockSize, long long overlap,
+        const std::vector<BasicKmerCounter*>& counters) {
+
+    NucleotideTranslator translator(codes);
+    auto read = [&input, &translator](unsigned char* buffer, int size) {
+        input.read(reinterpret_cast<char*>(buffer), size);
+        translator.translate(reinterpret_cast<char*>(buffer), input.gcount(), buffer);
+        return static_cast<int>(input.gcount());
+    };
+
+    return CountKmers(read, length, blockSize, overlap, counters);
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::CountKmers(const char* sequence, long long length,
+        const unsigned char codes[], int blockSize, long long overlap,
+        const std::vector<BasicKmerCounter*>& counters) {
+
+    NucleotideTranslator translator(codes);
+    auto read = [&sequence, &translator](unsigned char* buffer, int size) {
+        translator.translate(sequence, size, buffer);
+        sequence += size;
+        return size;
+    };
+
+    return CountKmers(read, length, blockSize, overlap, counters);
+}
+
+template <class Cell>
+template <class Read>
+bool BasicKmerCounter<Cell>::CountKmers(Read& read, long long length, int blockSize,
+        long long overlap, const std::vector<BasicKmerCounter*>& counters) {
+
+    // Each counter skips the characters of the overlap that are not part of
+    // a kmer that ends after it
+    int maxK = 0;
+    std::vector<EncodeFunction> encoders;
+    std::vector<long long> skips;
+    std::vector<unsigned char> complements(counters.size() * NUM_CHARACTERS);
+    for (size_t i = 0; i < counters.size(); i++) {
+        BasicKmerCounter& counter = *counters[i];
+        int k = counter.getK();
+        unsigned char* complement = nullptr;
+        if (counter._canonical) {
+            complement = &complements[i * NUM_CHARACTERS];
+            counter.getComplementCodes(complement);
+        }
+
+        unsigned long long base = counter.getCodeNucleotides().size();
+        if (counter._sparse)
+            encoders.push_back(KmerEncoderDispatch<1>::make(k, base, complement, 
+                    SparseIncrease{counter._table}));
+        else
+            encoders.push_back(KmerEncoderDispatch<1>::make(k, base, complement, 
+                    DenseIncrease<Cell>{counter._frequency[0], counter._spill}));
+        skips.push_back(std::max(overlap - (k - 1), 0LL));
+        maxK = std::max(maxK, k);
+    }
+
+    return EncodeSequence(read, length, blockSize, maxK, encoders, skips);
+}
+
+template <class Cell>
+Profile BasicKmerCounter<Cell>::toProfile() const {
+
+    // The codes are different, so the kmers are saved without searching them
+    std::vector<std::pair<unsigned long long, long long> > frequencies = getActiveFrequencies();
+    Profile profile(frequencies.size());
+    for (size_t i = 0; i < frequencies.size(); i++) {
+        profile[i].setKmer(getKmer(frequencies[i].first));
+        profile[i].setFrequency(frequencies[i].second);
+    }
 
     return profile;
 }
 
-int KmerCounter::getNumRows() const {
+template <class Cell>
+Profile BasicKmerCounter<Cell>::toSortedProfile(bool deleteMissing) const {
 
-    return std::pow(getNumNucleotides(), (getK() + 1) / 2);
+    // The code of each kmer is replaced by the code of the same kmer with 
+    // the nucleotides numbered in alphabetical order, so that the order of
+    // the codes is the order of the kmers (all of them have k nucleotides)
+    const std::string& codeNucleotides = getCodeNucleotides();
+    std::string sortedNucleotides(codeNucleotides);
+    std::sort(sortedNucleotides.begin(), sortedNucleotides.end());
+    unsigned long long base = codeNucleotides.size();
+    std::vector<unsigned long long> ranks(base);
+    for (unsigned long long digit = 0; digit < base; digit++)
+        ranks[digit] = sortedNucleotides.find(codeNucleotides[digit]);
+    unsigned long long missing = codeNucleotides.find(Kmer::MISSING_NUCLEOTIDE);
+
+    std::vector<std::pair<unsigned long long, long long> > frequencies = getActiveFrequencies();
+    size_t size = 0;
+    for (size_t i = 0; i < frequencies.size(); i++) {
+        unsigned long long code = frequencies[i].first, sortedCode = 0, weight = 1;
+        bool hasMissing = false;
+        for (int j = 0; j < getK(); j++) {
+            unsigned long long digit = code % base;
+            hasMissing = hasMissing || digit == missing;
+            sortedCode += ranks[digit] * weight;
+            weight *= base;
+            code /= base;
+        }
+        if (!deleteMissing || !hasMissing)
+            frequencies[size++] = std::make_pair(sortedCode, frequencies[i].second);
+    }
+    frequencies.resize(size);
+    RadixSortByFrequency(frequencies,
+            [](const std::pair<unsigned long long, long long>& pair) { return pair.first; },
+            [](const std::pair<unsigned long long, long long>& pair) { return pair.second; });
+
+    Profile profile(size);
+    std::string nucleotides(getK(), Kmer::MISSING_NUCLEOTIDE);
+    for (size_t i = 0; i < size; i++) {
+        unsigned long long code = frequencies[i].first;
+        for (int j = getK(); j > 0; j--) {
+            nucleotides[j - 1] = sortedNucleotides[code % base];
+            code /= base;
+        }
+        profile[i].setKmer(Kmer(nucleotides));
+        profile[i].setFrequency(frequencies[i].second);
+    }
+
+    return profile;
 }
 
-int KmerCounter::getNumCols() const {
+template <class Cell>
+int BasicKmerCounter<Cell>::getNumRows() const {
+
+    if (_sparse)
+        return 0;
 
-    return std::pow(getNumNucleotides(), getK() / 2);
+    return Power(getCodeNucleotides().size(), (getK() + 1) / 2);
 }
 
-int KmerCounter::getIndex(const std::string& kmer) const {
+template <class Cell>
+int BasicKmerCounter<Cell>::getNumCols() const {
+
+    if (_sparse)
+        return 0;
+
+    return Power(getCodeNucleotides().size(), getK() / 2);
+}
+
+template <class Cell>
+int BasicKmerCounter<Cell>::getIndex(const std::string& kmer) const {
+    const std::string& codeNucleotides = getCodeNucleotides();
     int index = 0;
     int base = 1;
 
     for (size_t i = 0; i < kmer.size(); i++) {
-        size_t pos = _allNucleotides.find(kmer[kmer.size() - i - 1]);
+        size_t pos = codeNucleotides.find(kmer[kmer.size() - i - 1]);
         if (pos == std::string::npos)
             return -1;
         index += pos * base;
-        base *= _allNucleotides.size();
+        base *= codeNucleotides.size();
     }
     return index;
 }
 
-std::string KmerCounter::getInvertedIndex(int index, int nCharacters) const {
+template <class Cell>
+std::string BasicKmerCounter<Cell>::getInvertedIndex(int index, int nCharacters) const {
+    const std::string& codeNucleotides = getCodeNucleotides();
     std::string result(nCharacters, Kmer::MISSING_NUCLEOTIDE);
 
     for (int i = result.size(); i > 0; i--) {
-        result[i - 1] = _allNucleotides[index % _allNucleotides.size()];
-        index = index / _allNucleotides.size();
+        result[i - 1] = codeNucleotides[index % codeNucleotides.size()];
+        index = index / codeNucleotides.size();
     }
     return result;
 }
 
-void KmerCounter::getRowColumn(const Kmer& kmer, int& row, int& column) const {
+template <class Cell>
+void BasicKmerCounter<Cell>::getRowColumn(const Kmer& kmer, int& row, int& column) const {
 
-    if (kmer.toString().find_first_not_of(_allNucleotides) != std::string::npos) {
+    if (kmer.toString().find_first_not_of(getCodeNucleotides()) != std::string::npos) {
         row = -1;
         column = -1;
     }
@@ -206,7 +917,126 @@ void KmerCounter::getRowColumn(const Kmer& kmer, int& row, int& column) const {
     }
 }
 
-Kmer KmerCounter::getKmer(int row, int column) const {
+template <class Cell>
+void BasicKmerCounter<Cell>::getComplementCodes(unsigned char complement[]) const {
+
+    // Complementary pairs: A-T (A-U if T is not a valid nucleotide) and C-G
+    std::string nucleotides = "ATCG", complementary = "TAGC";
+    if (!IsValidNucleotide('T', _validNucleotides)) {
+        nucleotides = "AUCG";
+        complementary = "UAGC";
+    }
+
+    const std::string& codeNucleotides = getCodeNucleotides();
+    for (size_t i = 0; i < codeNucleotides.size(); i++) {
+        size_t pos = nucleotides.find(codeNucleotides[i]);
+        if (pos != std::string::npos && IsValidNucleotide(complementary[pos], _validNucleotides))
+            complement[i] = codeNucleotides.find(complementary[pos]);
+        else
+            complement[i] = i;
+    }
+}
+
+template <class Cell>
+bool BasicKmerCounter<Cell>::getCode(const Kmer& kmer, unsigned long long& code) const {
+
+    const std::string& codeNucleotides = getCodeNucleotides();
+    std::string nucleotides = kmer.toString();
+    if (static_cast<int>(nucleotides.size()) != getK() ||
+            nucleotides.find_first_not_of(codeNucleotides) != std::string::npos)
+        return false;
+
+    code = 0;
+    for (size_t i = 0; i < nucleotides.size(); i++)
+        code = code * codeNucleotides.size() + codeNucleotides.find(nucleotides[i]);
+
+    return true;
+}
+
+template <class Cell>
+Kmer BasicKmerCounter<Cell>::getKmer(unsigned long long code) const {
+
+    const std::string& codeNucleotides = getCodeNucleotides();
+    std::string nucleotides(getK(), Kmer::MISSING_NUCLEOTIDE);
+    for (int i = getK(); i > 0; i--) {
+        nucleotides[i - 1] = codeNucleotides[code % codeNucleotides.size()];
+        code /= codeNucleotides.size();
+    }
+
+    return Kmer(nucleotides);
+}
+
+template <class Cell>
+std::vector<std::pair<unsigned long long, long long> > BasicKmerCounter<Cell>::getSparseFrequencies() const {
+
+    std::vector<std::pair<unsigned long long, long long> > frequencies;
+    frequencies.reserve(_table.getSize());
+    for (long long slot = 0; slot < _table.getCapacity(); slot++)
+        if (_table.getValue(slot) > 0)
+            frequencies.push_back(std::make_pair(_table.getKey(slot), _table.getValue(slot)));
+    std::sort(frequencies.begin(), frequencies.end());
+
+    return frequencies;
+}
+
+template <class Cell>
+std::vector<std::pair<unsigned long long, long long> > BasicKmerCounter<Cell>::getActiveFrequencies() const {
+
+    if (_sparse)
+        return getSparseFrequencies();
+
+    std::vector<std::pair<unsigned long long, long long> > frequencies;
+    unsigned long long numKmers = static_cast<unsigned long long>(getNumRows()) * getNumCols();
+    for (unsigned long long code = 0; code < numKmers; code++) {
+        long long frequency = getFrequency(code);
+        if (frequency > 0)
+            frequencies.push_back(std::make_pair(code, frequency));
+    }
+
+    return frequencies;
+}
+
+template <class Cell>
+long long BasicKmerCounter<Cell>::getFrequency(unsigned long long code) const {
+
+    long long frequency = _frequency[0][code];
+    if (_frequency[0][code] == std::numeric_limits<Cell>::max())
+        frequency += _spill.get(code);
+
+    return frequency;
+}
+
+template <class Cell>
+void BasicKmerCounter<Cell>::increaseCode(unsigned long long code, long long frequency) {
+
+    Cell& cell = _frequency[0][code];
+    long long room = std::numeric_limits<Cell>::max() - cell;
+    if (frequency <= room)
+        cell += frequency;
+    else {
+        _spill.increase(code, frequency - room);
+        cell = std::numeric_limits<Cell>::max();
+    }
+}
+
+template <class Cell>
+void BasicKmerCounter<Cell>::getNucleotideCodes(unsigned char codes[]) const {
+
+    for (int c = 0; c < NUM_CHARACTERS; c++) {
+        char nucleotide = toupper(c);
+        if (isspace(c))
+            codes[c] = SEQUENCE_END;
+        else if (IsValidNucleotide(nucleotide, _validNucleotides))
+            codes[c] = getCodeNucleotides().find(nucleotide);
+        else if (_skipMissing)
+            codes[c] = INVALID_NUCLEOTIDE;
+        else
+            codes[c] = _allNucleotides.find(Kmer::MISSING_NUCLEOTIDE);
+    }
+}
+
+template <class Cell>
+Kmer BasicKmerCounter<Cell>::getKmer(int row, int column) const {
     
     if (row < 0 || row >= getNumRows()) {
         
@@ -221,7 +1051,13 @@ Kmer KmerCounter::getKmer(int row, int column) const {
     return Kmer(getInvertedIndex(row, (getK() + 1) / 2) + getInvertedIndex(column, getK() / 2));
 }
 
-void KmerCounter::initFrequencies() {
+template <class Cell>
+void BasicKmerCounter<Cell>::initFrequencies() {
+
+    if (_sparse)
+        _table.clear();
+    else
+        _spill.clear();
 
     int rows = getNumRows(), cols = getNumCols();
     for (int r = 0; r < rows; r++)
@@ -229,50 +1065,72 @@ void KmerCounter::initFrequencies() {
             this->operator()(r, c) = 0;
 }
 
-const int& KmerCounter::operator()(int row, int column) const {
+template <class Cell>
+const Cell& BasicKmerCounter<Cell>::operator()(int row, int column) const {
 
     return _frequency[row][column];
 }
 
-int& KmerCounter::operator()(int row, int column) {
+template <class Cell>
+Cell& BasicKmerCounter<Cell>::operator()(int row, int column) {
 
     return _frequency[row][column];
 }
 
-void KmerCounter::allocate(int rows, int colums) {
+template <class Cell>
+void BasicKmerCounter<Cell>::allocate(int rows, int colums) {
 
-    _frequency = new int* [rows];
-    _frequency[0] = new int[rows * colums];
+    _frequency = new Cell* [rows];
+    _frequency[0] = new Cell[rows * colums];
     for (int i = 1; i < rows; i++)
         _frequency[i] = _frequency[i - 1] + colums;
 }
 
-void KmerCounter::deallocate() {
+template <class Cell>
+void BasicKmerCounter<Cell>::deallocate() {
 
-    delete[] _frequency[0];
-    delete[] _frequency;
+    if (_frequency != nullptr) {
+        delete[] _frequency[0];
+        delete[] _frequency;
+    }
     _frequency = nullptr;
     _k = 0;
     _validNucleotides = "";
     _allNucleotides = "";
 }
 
-void KmerCounter::copy(const KmerCounter& kmerCounter) {
+template <class Cell>
+void BasicKmerCounter<Cell>::copy(const BasicKmerCounter& kmerCounter) {
 
-    int rows = kmerCounter.getNumRows(), cols = kmerCounter.getNumCols();
-    int** frequency = new int*[rows];
-    frequency[0] = new int [rows * cols];
-    for (int i = 1; i < rows; i++)
-        frequency[i] = frequency[i - 1] + cols;
+    Cell** frequency = nullptr;
+    if (!kmerCounter._sparse) {
+        int rows = kmerCounter.getNumRows(), cols = kmerCounter.getNumCols();
+        frequency = new Cell*[rows];
+        frequency[0] = new Cell [rows * cols];
+        for (int i = 1; i < rows; i++)
+            frequency[i] = frequency[i - 1] + cols;
 
-    for (int r = 0; r < rows; r++)
-        for (int c = 0; c < cols; c++)
-            frequency[r][c] = kmerCounter(r, c);
+        for (int r = 0; r < rows; r++)
+            for (int c = 0; c < cols; c++)
+                frequency[r][c] = kmerCounter(r, c);
+    }
 
-    delete[] _frequency[0];
-    delete[] _frequency;
+    if (_frequency != nullptr) {
+        delete[] _frequency[0];
+        delete[] _frequency;
+    }
     _frequency = frequency;
     _k = kmerCounter.getK();
     _validNucleotides = kmerCounter._validNucleotides;
     _allNucleotides = kmerCounter._allNucleotides;
-}
\ No newline at end of file
+    _sparse = kmerCounter._sparse;
+    _table = kmerCounter._table;
+    _spill = kmerCounter._spill;
+    _canonical = kmerCounter._canonical;
+    _skipMissing = kmerCounter._skipMissing;
+}
+
+template class BasicKmerCounter<unsigned char>;
+template class BasicKmerCounter<unsigned short>;
+template class BasicKmerCounter<int>;
+template class BasicKmerCounter<long long>;
@@ -13,6 +13,8 @@
  * Created on 27 de octubre de 2023, 11:03
  */
 
+#include <limits>
+
 #include "KmerFreq.h"
 
 KmerFreq::KmerFreq() : _kmer(Kmer()), _frequency(0) {}
@@ -22,7 +24,7 @@ const Kmer& KmerFreq::getKmer() const {
     return _kmer;
 }
 
-int KmerFreq::getFrequency() const {
+long long KmerFreq::getFrequency() const {
 
     return _frequency;
 }
@@ -32,10 +34,10 @@ void KmerFreq::setKmer(const Kmer& kmer) {
     _kmer = kmer;
 }
 
-void KmerFreq::setFrequency(int frequency) {
+void KmerFreq::setFrequency(long long frequency) {
 
     if (frequency < 0)
-        throw std::out_of_range("void KmerFreq::setFrequency(int frequency): frequency is negative");
+        throw std::out_of_range("void KmerFreq::setFrequency(long long frequency): frequency is negative");
 
     _frequency = frequency;
 }
@@ -45,16 +47,29 @@ std::string KmerFreq::toString() const {
     return getKmer().toString() + " " + std::to_string(getFrequency());
 }
 
-void KmerFreq::write(std::ostream& outputStream) const {
+void KmerFreq::write(std::ostream& outputStream, bool wideFrequency) const {
 
     getKmer().write(outputStream);
-    outputStream.write(reinterpret_cast<const char*>(&_frequency), sizeof(_frequency)); 
+    if (wideFrequency)
+        outputStream.write(reinterpret_cast<const char*>(&_frequency), sizeof(_frequency)); 
+    else {
+        if (_frequency > std::numeric_limits<int>::max())
+            throw std::out_of_range("void KmerFreq::write(std::ostream& outputStream, bool wideFrequency) const: the frequency does not fit in an int");
+        int frequency = _frequency;
+        outputStream.write(reinterpret_cast<const char*>(&frequency), sizeof(frequency)); 
+    }
 }
 
-void KmerFreq::read(std::istream& inputStream) {
+void KmerFreq::read(std::istream& inputStream, bool wideFrequency) {
     
     _kmer.read(inputStream);
-    inputStream.read(reinterpret_cast<char*>(&_frequency), sizeof(_frequency));
+    if (wideFrequency)
+        inputStream.read(reinterpret_cast<char*>(&_frequency), sizeof(_frequency));
+    else {
+        int frequency = 0;
+        inputStream.read(reinterpret_cast<char*>(&frequency), sizeof(frequency));
+        _frequency = frequency;
+    }
 }
 
 std::ostream& operator<<(std::ostream& os, const KmerFreq& kmerFreq) {
@@ -67,7 +82,7 @@ std::ostream& operator<<(std::ostream& os, const KmerFreq& kmerFreq) {
 std::istream& operator>>(std::istream& is, KmerFreq& kmerFreq) {
     
     Kmer kmer;
-    int frequency;
+    long long frequency;
     is >> kmer >> frequency;
     kmerFreq.setKmer(kmer);
     kmerFreq.setFrequency(frequency);
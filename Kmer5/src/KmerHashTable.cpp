@@ -0,0 +1,177 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file KmerHashTable.cpp
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "KmerHashTable.h"
+
+const unsigned long long KmerHashTable::EMPTY_KEY;
+const long long KmerHashTable::INITIAL_CAPACITY;
+const int KmerHashTable::MAX_LOAD_PERCENT;
+
+/**
+ * @brief Mixes the bits of the given key (finalizer of MurmurHash3), so
+ * that consecutive codes of kmers are spread over the whole table
+ * @param key A key
+ * @return The hash of the key
+ */
+static unsigned long long Hash(unsigned long long key) {
+
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+
+    return key;
+}
+
+KmerHashTable::KmerHashTable(long long capacity) {
+
+    if (capacity < 1)
+        throw std::invalid_argument("KmerHashTable::KmerHashTable(long long capacity): capacity is less than 1");
+
+    long long powerOfTwo = 1;
+    while (powerOfTwo < capacity)
+        powerOfTwo *= 2;
+    allocate(powerOfTwo);
+}
+
+KmerHashTable::KmerHashTable(const KmerHashTable& orig) {
+
+    allocate(orig._capacity);
+    copy(orig);
+}
+
+KmerHashTable::~KmerHashTable() {
+
+    deallocate();
+}
+
+KmerHashTable& KmerHashTable::operator=(const KmerHashTable& orig) {
+
+    if (&orig != this) {
+        if (orig._capacity != _capacity) {
+            deallocate();
+            allocate(orig._capacity);
+        }
+        copy(orig);
+    }
+
+    return *this;
+}
+
+long long KmerHashTable::getSize() const {
+
+    return _size;
+}
+
+long long KmerHashTable::getCapacity() const {
+
+    return _capacity;
+}
+
+unsigned long long KmerHashTable::getKey(long long slot) const {
+
+    return _keys[slot];
+}
+
+long long KmerHashTable::getValue(long long slot) const {
+
+    return _values[slot];
+}
+
+long long KmerHashTable::get(unsigned long long key) const {
+
+    return _values[findSlot(key)];
+}
+
+void KmerHashTable::increase(unsigned long long key, long long value) {
+
+    long long slot = findSlot(key);
+    if (_keys[slot] == EMPTY_KEY) {
+        if ((_size + 1) * 100 > _capacity * MAX_LOAD_PERCENT) {
+            rehash(_capacity * 2);
+            slot = findSlot(key);
+        }
+        _keys[slot] = key;
+        _size++;
+    }
+    _values[slot] += value;
+}
+
+void KmerHashTable::add(const KmerHashTable& table) {
+
+    for (long long slot = 0; slot < table._capacity; slot++)
+        if (table._keys[slot] != EMPTY_KEY)
+            increase(table._keys[slot], table._values[slot]);
+}
+
+void KmerHashTable::clear() {
+
+    std::fill(_keys, _keys + _capacity, EMPTY_KEY);
+    std::fill(_values, _values + _capacity, 0);
+    _size = 0;
+}
+
+long long KmerHashTable::findSlot(unsigned long long key) const {
+
+    long long mask = _capacity - 1;
+    long long slot = Hash(key) & mask;
+    while (_keys[slot] != EMPTY_KEY && _keys[slot] != key)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+void KmerHashTable::rehash(long long capacity) {
+
+    unsigned long long* keys = _keys;
+    long long* values = _values;
+    long long oldCapacity = _capacity;
+    allocate(capacity);
+    for (long long slot = 0; slot < oldCapacity; slot++)
+        if (keys[slot] != EMPTY_KEY) {
+            long long newSlot = findSlot(keys[slot]);
+            _keys[newSlot] = keys[slot];
+            _values[newSlot] = values[slot];
+            _size++;
+        }
+
+    delete[] keys;
+    delete[] values;
+}
+
+void KmerHashTable::allocate(long long capacity) {
+
+    _keys = new unsigned long long[capacity];
+    _values = new long long[capacity];
+    _capacity = capacity;
+    clear();
+}
+
+void KmerHashTable::deallocate() {
+
+    delete[] _keys;
+    delete[] _values;
+    _keys = nullptr;
+    _values = nullptr;
+    _capacity = 0;
+    _size = 0;
+}
+
+void KmerHashTable::copy(const KmerHashTable& table) {
+
+    std::copy(table._keys, table._keys + _capacity, _keys);
+    std::copy(table._values, table._values + _capacity, _values);
+    _size = table._size;
+}
@@ -3,9 +3,16 @@
  * Curso 2023/2024
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <vector>
 
 #include "KmerCounter.h"
+#include "Parallel.h"
 
 /** 
  * @file LEARN.cpp
@@ -25,15 +32,22 @@
 void showEnglishHelp(std::ostream& outputStream) {
     outputStream << "ERROR in LEARN parameters" << std::endl;
     outputStream << "Run with the following parameters:" << std::endl;
-    outputStream << "LEARN [-t|-b] [-k kValue] [-n nucleotidesSet] [-p profileId] [-o outputFilename] <file1.dna> [<file2.dna> <file3.dna> .... ]" << std::endl;
+    outputStream << "LEARN [-t|-b] [-k kValues] [-n nucleotidesSet] [-p profileId] [-o outputFilename] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] <file1.dna> [<file2.dna> <file3.dna> .... ]" << std::endl;
     outputStream << std::endl;
     outputStream << "Parameters:" << std::endl;
     outputStream << "-t|-b: text mode or binary mode for the output file (-t by default)" << std::endl;
-    outputStream << "-k kValue: number of nucleotides in a kmer (5 by default)" << std::endl;
+    outputStream << "-k kValues: number of nucleotides in a kmer (5 by default), or a range (for example, 1-8) "
+            << "or a list (for example, 2,4,6) of them to learn the kmers of each length in a single scan of the input files" << std::endl;
     outputStream << "-n nucleotidesSet: set of possible nucleotides in a kmer (ACGT by default). "
             << "Note that the characters should be provided in uppercase" << std::endl;
     outputStream << "-p profileId: profile identifier (unknown by default)" << std::endl;
     outputStream << "-o outputFilename: name of the output file (output.prf by default)" << std::endl;
+    outputStream << "-s blockSize: number of characters read from the input files in each block ("
+            << KmerCounter::DEFAULT_BLOCK_SIZE << " by default)" << std::endl;
+    outputStream << "-j numThreads: number of threads used to count the kmers of the input files (1 by default)" << std::endl;
+    outputStream << "-c: canonical mode, each kmer is counted together with its reverse complement" << std::endl;
+    outputStream << "-w counterWidth: number of bits (8, 16, 32 or 64) of each counter of kmers (32 by default). "
+            << "A greater frequency is kept apart, so it only changes the memory used" << std::endl;
     outputStream << "<file1.dna> <file2.dna> <file3.dna> ....: names of the input files (at least one is mandatory)" << std::endl;
     outputStream << std::endl;
     outputStream << "This program learns a profile model from a set of " <<
@@ -41,15 +55,154 @@ void showEnglishHelp(std::ostream& outputStream) {
     outputStream << std::endl;
 }
 
+/**
+ * Obtains a positive integer from the value of a parameter
+ * @param text The value of the parameter
+ * @param value The integer. Output parameter
+ * @return true if @p text is a positive integer that fits in an int; false 
+ * otherwise
+ */
+bool ParsePositiveInt(const char* text, int& value) {
+
+    char* end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || number < 1 || number > INT_MAX)
+        return false;
+    value = number;
+
+    return true;
+}
+
+/**
+ * Obtains the size (number of characters) of the given file
+ * @param fileName The name of the file
+ * @return The size of the file, or -1 if it cannot be obtained
+ */
+long long FileSize(const char* fileName) {
+
+    std::ifstream input(fileName, std::ios_base::ate);
+    if (!input)
+        return -1;
+
+    return input.tellg();
+}
+
+/**
+ * Obtains the values of k given in the parameter -k: a number, a range of
+ * numbers (first-last) or a list of numbers and ranges separated by commas
+ * @param text The value of the parameter -k
+ * @param kValues The values of k, in increasing order and without repeated
+ * values
+ * @return false if a value is not a positive integer or a range has its 
+ * first value greater than the last one; true otherwise
+ */
+bool ParseKValues(const std::string& text, std::vector<int>& kValues) {
+
+    kValues.clear();
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string item = text.substr(begin, end - begin);
+        size_t dash = item.find('-', 1);
+        if (dash == std::string::npos) {
+            int k;
+            if (!ParsePositiveInt(item.c_str(), k))
+                return false;
+            kValues.push_back(k);
+        }
+        else {
+            int first, last;
+            if (!ParsePositiveInt(item.substr(0, dash).c_str(), first) ||
+                    !ParsePositiveInt(item.substr(dash + 1).c_str(), last) ||
+                    first > last)
+                return false;
+            for (int k = first; k <= last; k++)
+                kValues.push_back(k);
+        }
+        begin = end + 1;
+    }
+
+    std::sort(kValues.begin(), kValues.end());
+    kValues.erase(std::unique(kValues.begin(), kValues.end()), kValues.end());
+
+    return true;
+}
+
+/**
+ * Obtains the Profile of a set of input DNA files, using a BasicKmerCounter
+ * with counters of type Cell for each value of k. Each file is read only 
+ * once for all the values of k. The kmers with any missing nucleotide are
+ * skipped while counting
+ * @param fileNames The names of the input files
+ * @param numFiles The number of input files
+ * @param kValues The numbers of nucleotides in the kmers
+ * @param nucleotidesSet The set of valid nucleotides
+ * @param canonical true to count the kmers in canonical mode
+ * @param blockSize The number of characters read in each block
+ * @param numThreads The number of threads used to count the kmers
+ * @return The Profile of the input files, with the kmers of all the values
+ * of k, sorted by decreasing frequency
+ */
+template <class Cell>
+Profile LearnProfile(char* fileNames[], int numFiles, const std::vector<int>& kValues,
+        const std::string& nucleotidesSet, bool canonical, int blockSize,
+        int numThreads) {
+
+    // Calculate the kmer frecuencies of the input genome files using a 
+    // BasicKmerCounter object for each worker thread. The files are scheduled
+    // from the largest one to the smallest one; the threads that are not
+    // needed as workers count each file by ranges
+    int numWorkers = std::max(1, std::min(numThreads, numFiles));
+    int numFileThreads = numThreads / numWorkers;
+    std::vector<long long> fileSizes(numFiles);
+    for (int i = 0; i < numFiles; i++)
+        fileSizes[i] = FileSize(fileNames[i]);
+
+    // The kmers with missing nucleotides are skipped while counting, so the
+    // Profile does not need to be zipped
+    std::vector<BasicKmerCounter<Cell> > kmerCounters;
+    for (size_t i = 0; i < kValues.size(); i++) {
+        kmerCounters.push_back(BasicKmerCounter<Cell>(kValues[i], nucleotidesSet,
+                BasicKmerCounter<Cell>::IsSparseBetter(kValues[i], nucleotidesSet, true), true));
+        kmerCounters.back().setCanonical(canonical);
+    }
+    std::vector<std::vector<BasicKmerCounter<Cell> > > workerCounters(numWorkers - 1, kmerCounters);
+    ParallelForTasks(numWorkers, fileSizes, [&](int worker, int file) {
+        std::vector<BasicKmerCounter<Cell> >& counters = worker == 0 ? kmerCounters : workerCounters[worker - 1];
+        std::vector<BasicKmerCounter<Cell>*> pointers;
+        for (size_t i = 0; i < counters.size(); i++)
+            pointers.push_back(&counters[i]);
+        BasicKmerCounter<Cell>::AddFrequencies(pointers, fileNames[file], blockSize, numFileThreads);
+    });
+
+    for (size_t i = 0; i < kmerCounters.size(); i++)
+        for (size_t worker = 0; worker < workerCounters.size(); worker++)
+            kmerCounters[i].add(workerCounters[worker][i], numThreads);
+
+    if (kmerCounters.size() == 1)
+        return kmerCounters[0].toSortedProfile();
+
+    // Join the profiles of all the values of k
+    Profile profile;
+    for (size_t i = 0; i < kmerCounters.size(); i++)
+        profile += kmerCounters[i].toProfile();
+    profile.sort(numThreads);
+
+    return profile;
+}
+
 /**
  * This program learns a Profile model from a set of input DNA files (file1.dna,
- * file2.dna, ...). The learned Profile object is then zipped (kmers with any 
- * missing nucleotide or with frequency equals to zero will be removed) 
- * and ordered by frequency and saved in 
+ * file2.dna, ...). The kmers with any missing nucleotide are skipped while
+ * counting, and the learned Profile object is ordered by frequency and 
+ * saved in 
  * the file outputFilename (or output.prf if the output file is not provided).
  * 
  * Running sintax:
- * > LEARN [-t|-b] [-k kValue] [-n nucleotidesSet] [-p profileId] [-o outputFilename] <file1.dna> [<file2.dna> <file3.dna> ....]
+ * > LEARN [-t|-b] [-k kValues] [-n nucleotidesSet] [-p profileId] [-o outputFilename] [-s blockSize] [-j numThreads] [-c] [-w counterWidth] <file1.dna> [<file2.dna> <file3.dna> ....]
  * 
  * Running example:
  * > LEARN -k 2 -p bug -o /tmp/unknownACGT.prf ../Genomes/unknownACGT.dna
@@ -80,10 +233,14 @@ int main(int argc, char *argv[]) {
     int pos = 1;
     bool continues = true;
     char mode = 't';
-    int kValue = 5;
+    std::vector<int> kValues(1, 5);
     std::string nucleotidesSet = "ACGT";
     std::string profileId;
     std::string outputFilename = "output.prf";
+    int blockSize = KmerCounter::DEFAULT_BLOCK_SIZE;
+    int numThreads = 1;
+    bool canonical = false;
+    int counterWidth = 32;
     while (pos < argc && continues) {
         if (argv[pos][0] == '-') {
             if (strlen(argv[pos]) == 2) {
@@ -99,7 +256,10 @@ int main(int argc, char *argv[]) {
                         
                     case 'k':
                         if (pos + 1 < argc) {
-                            kValue = atoi(argv[pos + 1]);
+                            if (!ParseKValues(argv[pos + 1], kValues)) {
+                                showEnglishHelp(std::cerr);
+                                return 1;
+                            }
                             pos += 2;
                         }
                         
@@ -149,6 +309,44 @@ int main(int argc, char *argv[]) {
                         
                         break;
 
+                    case 's':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], blockSize))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
+                    case 'j':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], numThreads))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
+                    case 'c':
+                        canonical = true;
+                        pos++;
+                        break;
+
+                    case 'w':
+                        if (pos + 1 < argc && ParsePositiveInt(argv[pos + 1], counterWidth))
+                            pos += 2;
+                        
+                        else {
+                            showEnglishHelp(std::cerr);
+                            return 1;
+                        }
+                        
+                        break;
+
                     default:
                         showEnglishHelp(std::cerr);
                         return 1;
@@ -171,29 +369,46 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Loop to calculate the kmer frecuencies of the input genome files using a KmerCounter object
-    KmerCounter kmerCounter(kValue, nucleotidesSet);
-    
-    while (pos < argc) {
-        KmerCounter tmp(kValue, nucleotidesSet);
-        tmp.calculateFrequencies(argv[pos]);
-        kmerCounter += tmp;
-        pos++;
+    // Obtain a sorted Profile object from the input files, with counters of
+    // counterWidth bits
+    int numFiles = argc - pos;
+    Profile profile;
+    try {
+        switch (counterWidth) {
+            case 8:
+                profile = LearnProfile<unsigned char>(argv + pos, numFiles, kValues,
+                        nucleotidesSet, canonical, blockSize, numThreads);
+                break;
+
+            case 16:
+                profile = LearnProfile<unsigned short>(argv + pos, numFiles, kValues,
+                        nucleotidesSet, canonical, blockSize, numThreads);
+                break;
+
+            case 32:
+                profile = LearnProfile<int>(argv + pos, numFiles, kValues,
+                        nucleotidesSet, canonical, blockSize, numThreads);
+                break;
+
+            case 64:
+                profile = LearnProfile<long long>(argv + pos, numFiles, kValues,
+                        nucleotidesSet, canonical, blockSize, numThreads);
+                break;
+
+            default:
+                showEnglishHelp(std::cerr);
+                return 1;
+        }
+    } catch (const std::exception& exception) {
+        std::cerr << "ERROR in LEARN: " << exception.what() << std::endl;
+        return 1;
     }
 
-    // Obtain a Profile object from the KmerCounter object
-    Profile profile = kmerCounter.toProfile();
     if (!profileId.empty())
         profile.setProfileId(profileId);
 
-    // Zip the Profile object
-    profile.zip(true);
-
-    // Sort the Profile object
-    profile.sort();
-
     // Save the Profile object in the output file
-    profile.save(outputFilename.c_str(), mode);
+    profile.save(outputFilename.c_str(), mode, numThreads);
 
     return 0;
 }
\ No newline at end of file
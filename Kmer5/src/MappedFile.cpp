@@ -0,0 +1,73 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file MappedFile.cpp
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const char* fileName) : _data(nullptr), _size(0) {
+
+#ifdef MAPPED_FILE_MMAP
+    int descriptor = open(fileName, O_RDONLY);
+    if (descriptor < 0)
+        return;
+
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+        void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (data != MAP_FAILED) {
+            // The hints are not needed for reading the file, so their errors
+            // are ignored
+            madvise(data, status.st_size, MADV_SEQUENTIAL);
+            madvise(data, status.st_size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            madvise(data, status.st_size, MADV_HUGEPAGE);
+#endif
+            _data = static_cast<const char*>(data);
+            _size = status.st_size;
+        }
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    close(descriptor);
+#else
+    (void) fileName;
+#endif
+}
+
+MappedFile::~MappedFile() {
+
+#ifdef MAPPED_FILE_MMAP
+    if (_data != nullptr)
+        munmap(const_cast<char*>(_data), _size);
+#endif
+}
+
+bool MappedFile::isMapped() const {
+
+    return _data != nullptr;
+}
+
+const char* MappedFile::getData() const {
+
+    return _data;
+}
+
+long long MappedFile::getSize() const {
+
+    return _size;
+}
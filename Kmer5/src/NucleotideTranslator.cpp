@@ -0,0 +1,214 @@
+/*
+ * Metodología de la Programación: Kmer5
+ * Curso 2023/2024
+ */
+
+/**
+ * @file NucleotideTranslator.cpp
+ *
+ * Created on 17 October 2026, 10:00
+ */
+
+#include <cctype>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define NUCLEOTIDE_TRANSLATOR_SSE2
+#if defined(__x86_64__) || defined(__i386__)
+#define NUCLEOTIDE_TRANSLATOR_AVX2
+#endif
+#endif
+
+#include "NucleotideTranslator.h"
+
+const int NucleotideTranslator::NUM_CHARACTERS;
+const int NucleotideTranslator::MAX_LETTERS;
+
+/**
+ * @brief Checks if the given character is a whitespace, in the same way
+ * as isspace() in the "C" locale
+ * @param character A character
+ * @return true if @p character is a whitespace; false otherwise
+ */
+static bool IsSpace(unsigned char character) {
+
+    return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+#ifdef NUCLEOTIDE_TRANSLATOR_SSE2
+/**
+ * @brief Translates 16 characters: a whitespace gets @p spaceCode, a letter
+ * in @p letters (without case) gets its code and any other character gets
+ * @p otherCode
+ * @param characters 16 characters. Input parameter
+ * @param spaceCode The code of the whitespaces. Input parameter
+ * @param otherCode The code of the characters without own code.
+ * Input parameter
+ * @param numLetters The number of letters with their own code.
+ * Input parameter
+ * @param letters The letters (lowercase) with their own code.
+ * Input parameter
+ * @param letterCodes The code of each letter. Input parameter
+ * @return The 16 codes
+ */
+static __m128i Translate16(__m128i characters, unsigned char spaceCode,
+        unsigned char otherCode, int numLetters, const unsigned char letters[],
+        const unsigned char letterCodes[]) {
+
+    // Setting the bit 0x20 of a letter gives its lowercase letter
+    __m128i folded = _mm_or_si128(characters, _mm_set1_epi8(0x20));
+    __m128i result = _mm_set1_epi8(otherCode);
+    for (int i = 0; i < numLetters; i++) {
+        __m128i mask = _mm_cmpeq_epi8(folded, _mm_set1_epi8(letters[i]));
+        result = _mm_or_si128(_mm_andnot_si128(mask, result),
+                _mm_and_si128(mask, _mm_set1_epi8(letterCodes[i])));
+    }
+
+    // A character c in ['\t', '\r'] gives c - '\t' <= 4 (as unsigned)
+    __m128i shifted = _mm_sub_epi8(characters, _mm_set1_epi8('\t'));
+    __m128i mask = _mm_or_si128(
+            _mm_cmpeq_epi8(characters, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted));
+
+    return _mm_or_si128(_mm_andnot_si128(mask, result),
+            _mm_and_si128(mask, _mm_set1_epi8(spaceCode)));
+}
+#endif
+
+#ifdef NUCLEOTIDE_TRANSLATOR_AVX2
+/**
+ * @brief Translates 32 characters in the same way as Translate16()
+ * @param characters 32 characters. Input parameter
+ * @param spaceCode The code of the whitespaces. Input parameter
+ * @param otherCode The code of the characters without own code.
+ * Input parameter
+ * @param numLetters The number of letters with their own code.
+ * Input parameter
+ * @param letters The letters (lowercase) with their own code.
+ * Input parameter
+ * @param letterCodes The code of each letter. Input parameter
+ * @return The 32 codes
+ */
+__attribute__((target("avx2")))
+static __m256i Translate32(__m256i characters, unsigned char spaceCode,
+        unsigned char otherCode, int numLetters, const unsigned char letters[],
+        const unsigned char letterCodes[]) {
+
+    __m256i folded = _mm256_or_si256(characters, _mm256_set1_epi8(0x20));
+    __m256i result = _mm256_set1_epi8(otherCode);
+    for (int i = 0; i < numLetters; i++) {
+        __m256i mask = _mm256_cmpeq_epi8(folded, _mm256_set1_epi8(letters[i]));
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi8(letterCodes[i]), mask);
+    }
+
+    __m256i shifted = _mm256_sub_epi8(characters, _mm256_set1_epi8('\t'));
+    __m256i mask = _mm256_or_si256(
+            _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted));
+
+    return _mm256_blendv_epi8(result, _mm256_set1_epi8(spaceCode), mask);
+}
+
+/**
+ * @brief Translates the given characters with AVX2 instructions, 32
+ * characters at once. The last size % 32 characters are not translated
+ * @param characters An array of characters. Input parameter
+ * @param size The number of characters. Input parameter
+ * @param translated The code of each character. Output parameter
+ * @param spaceCode The code of the whitespaces. Input parameter
+ * @param otherCode The code of the characters without own code.
+ * Input parameter
+ * @param numLetters The number of letters with their own code.
+ * Input parameter
+ * @param letters The letters (lowercase) with their own code.
+ * Input parameter
+ * @param letterCodes The code of each letter. Input parameter
+ * @return The number of translated characters
+ */
+__attribute__((target("avx2")))
+static long long TranslateAVX2(const char* characters, long long size,
+        unsigned char translated[], unsigned char spaceCode,
+        unsigned char otherCode, int numLetters, const unsigned char letters[],
+        const unsigned char letterCodes[]) {
+
+    long long i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(characters + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(translated + i),
+                Translate32(block, spaceCode, otherCode, numLetters, letters, letterCodes));
+    }
+
+    return i;
+}
+#endif
+
+NucleotideTranslator::NucleotideTranslator(const unsigned char codes[]) :
+_vectorized(false), _avx2(false), _spaceCode(codes[' ']), _otherCode(codes[0]),
+_numLetters(0) {
+
+    for (int c = 0; c < NUM_CHARACTERS; c++)
+        _codes[c] = codes[c];
+
+    // The letters with their own code, if the uppercase and the lowercase
+    // letters have the same code
+    bool simple = true;
+    for (int c = 'a'; c <= 'z' && simple; c++)
+        if (codes[c] != codes[toupper(c)])
+            simple = false;
+        else if (codes[c] != _otherCode) {
+            if (_numLetters < MAX_LETTERS) {
+                _letters[_numLetters] = c;
+                _letterCodes[_numLetters] = codes[c];
+                _numLetters++;
+            }
+            else
+                simple = false;
+        }
+
+    // The vectorized translation is used only if it gives the same code for
+    // each character
+    for (int c = 0; c < NUM_CHARACTERS && simple; c++) {
+        unsigned char code = _otherCode;
+        if (IsSpace(c))
+            code = _spaceCode;
+        else
+            for (int i = 0; i < _numLetters; i++)
+                if ((c | 0x20) == _letters[i])
+                    code = _letterCodes[i];
+        if (code != codes[c])
+            simple = false;
+    }
+
+#ifdef NUCLEOTIDE_TRANSLATOR_SSE2
+    _vectorized = simple;
+#endif
+#ifdef NUCLEOTIDE_TRANSLATOR_AVX2
+    _avx2 = _vectorized && __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool NucleotideTranslator::isVectorized() const {
+
+    return _vectorized;
+}
+
+void NucleotideTranslator::translate(const char* characters, long long size, unsigned char translated[]) const {
+
+    long long i = 0;
+#ifdef NUCLEOTIDE_TRANSLATOR_AVX2
+    if (_avx2)
+        i = TranslateAVX2(characters, size, translated, _spaceCode, _otherCode,
+                _numLetters, _letters, _letterCodes);
+#endif
+#ifdef NUCLEOTIDE_TRANSLATOR_SSE2
+    if (_vectorized)
+        for (; i + 16 <= size; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(translated + i),
+                    Translate16(block, _spaceCode, _otherCode, _numLetters, _letters, _letterCodes));
+        }
+#endif
+
+    for (; i < size; i++)
+        translated[i] = _codes[static_cast<unsigned char>(characters[i])];
+}
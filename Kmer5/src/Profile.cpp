@@ -13,13 +13,212 @@
  * Created on 29 January 2023, 11:00
  */
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <limits>
+#include <utility>
 
+#include "MappedFile.h"
 #include "Profile.h"
+#include "RadixSort.h"
 
 const std::string Profile::MAGIC_STRING_T="MP-KMER-T-1.0";
 const std::string Profile::MAGIC_STRING_B="MP-KMER-B-1.0";
+const std::string Profile::MAGIC_STRING_B_WIDE="MP-KMER-B-1.1";
+const std::string Profile::MAGIC_STRING_B_PACKED="MP-KMER-B-2.0";
+
+/**
+ * Alignment (in bytes) of the sections of a file in the packed binary format
+ */
+const int PACKED_ALIGNMENT = 8;
+
+/**
+ * Maximum length of the kmers in the packed binary format
+ */
+const int MAX_PACKED_K = 64;
+
+/**
+ * Flags of the byte order of the numbers of a file in the packed binary 
+ * format. Their values are different when the bytes of the flags are 
+ * reversed, so a file saved with the other byte order is detected
+ */
+const int PACKED_LITTLE_ENDIAN = 1;
+const int PACKED_BIG_ENDIAN = 2;
+const int PACKED_BYTE_ORDER = PACKED_LITTLE_ENDIAN | PACKED_BIG_ENDIAN;
+
+/**
+ * @brief Header of a file in the packed binary format (see 
+ * Profile::savePacked())
+ */
+struct PackedHeader {
+    long long numKmers; ///< Number of kmers
+    int k; ///< Length of the kmers
+    int alphabetSize; ///< Number of different nucleotides
+    int idSize; ///< Number of characters of the profile identifier
+    int flags; ///< Byte order (PACKED_LITTLE_ENDIAN or PACKED_BIG_ENDIAN); the rest of bits are reserved (0)
+    unsigned long long checksum; ///< Checksum of the codes and frequencies (see Checksum())
+};
+
+/**
+ * @brief Returns the number of padding bytes needed after @p size bytes to
+ * reach a multiple of PACKED_ALIGNMENT
+ * @param size A number of bytes
+ * @return The number of padding bytes
+ */
+static long long Padding(long long size) {
+
+    return (PACKED_ALIGNMENT - size % PACKED_ALIGNMENT) % PACKED_ALIGNMENT;
+}
+
+/**
+ * @brief Returns the flag of the byte order of this machine
+ * @return PACKED_LITTLE_ENDIAN or PACKED_BIG_ENDIAN
+ */
+static int NativeByteOrder() {
+
+    const unsigned short one = 1;
+
+    return *reinterpret_cast<const unsigned char*>(&one) == 1 ? 
+        PACKED_LITTLE_ENDIAN : PACKED_BIG_ENDIAN;
+}
+
+/**
+ * @brief Obtains the number of possible codes of the kmers of length @p k
+ * with @p base different nucleotides in the packed binary format
+ * @param k The length of the kmers
+ * @param base The number of different nucleotides
+ * @param numCodes base^k. Output parameter
+ * @return false if @p k is greater than MAX_PACKED_K or base^k does not
+ * fit in an unsigned long long; true otherwise
+ */
+static bool PackedNumCodes(int k, unsigned long long base, unsigned long long& numCodes) {
+
+    if (k > MAX_PACKED_K)
+        return false;
+    numCodes = 1;
+    for (int j = 0; j < k; j++) {
+        if (numCodes > std::numeric_limits<unsigned long long>::max() / base)
+            return false;
+        numCodes *= base;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks if the given character is a whitespace, in the same way
+ * as isspace() in the "C" locale
+ * @param character A character
+ * @return true if @p character is a whitespace; false otherwise
+ */
+static bool IsSpace(char character) {
+
+    return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+/**
+ * @brief Returns the position of the first character that is not a
+ * whitespace, from @p position
+ * @param position The first character. Input parameter
+ * @param end The end of the characters. Input parameter
+ * @return The position of the first character that is not a whitespace, or
+ * @p end if there is none
+ */
+static const char* SkipSpaces(const char* position, const char* end) {
+
+    while (position != end && IsSpace(*position))
+        position++;
+
+    return position;
+}
+
+/**
+ * @brief Parses an integer number after some whitespaces, with an optional
+ * sign, as the operator >> of an input stream
+ * @param position The first character. It is moved after the number.
+ * Input/output parameter
+ * @param end The end of the characters. Input parameter
+ * @param number The number. Output parameter
+ * @return false if there is no number or it does not fit in a long long;
+ * true otherwise
+ */
+static bool ParseNumber(const char*& position, const char* end, long long& number) {
+
+    const char* current = SkipSpaces(position, end);
+    bool negative = false;
+    if (current != end && (*current == '-' || *current == '+')) {
+        negative = *current == '-';
+        current++;
+    }
+
+    const char* digits = current;
+    unsigned long long value = 0;
+    unsigned long long limit = negative ? 
+        static_cast<unsigned long long>(std::numeric_limits<long long>::max()) + 1 :
+        std::numeric_limits<long long>::max();
+    for (; current != end && *current >= '0' && *current <= '9'; current++) {
+        unsigned digit = *current - '0';
+        if (value > (limit - digit) / 10)
+            return false;
+        value = value * 10 + digit;
+    }
+    if (current == digits)
+        return false;
+
+    number = negative ? static_cast<long long>(0 - value) : static_cast<long long>(value);
+    position = current;
+    return true;
+}
+
+/**
+ * @brief Appends the decimal digits of the given number to a string, as the
+ * operator << of an output stream
+ * @param buffer A string. Output parameter
+ * @param number A number. Input parameter
+ */
+static void AppendNumber(std::string& buffer, long long number) {
+
+    char digits[24];
+    int position = sizeof(digits);
+    unsigned long long value = number < 0 ? 0 - static_cast<unsigned long long>(number) : number;
+    do {
+        digits[--position] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    if (number < 0)
+        digits[--position] = '-';
+
+    buffer.append(digits + position, sizeof(digits) - position);
+}
+
+/**
+ * @brief Returns the checksum (FNV-1a on 64-bit words) of the given numbers
+ * @param numbers An array of 64-bit numbers
+ * @param size The number of elements of @p numbers
+ * @param checksum The initial checksum, to continue a previous one
+ * @return The checksum
+ */
+static unsigned long long Checksum(const unsigned long long* numbers, long long size,
+        unsigned long long checksum = 14695981039346656037ULL) {
+
+    for (long long i = 0; i < size; i++) {
+        checksum ^= numbers[i];
+        checksum *= 1099511628211ULL;
+    }
+
+    return checksum;
+}
+
+/**
+ * @brief Key of a KmerFreq used by Profile::sort()
+ */
+struct SortKey {
+    unsigned long long code; ///< Code of the kmer (in alphabetical order)
+    long long frequency; ///< Frequency of the kmer
+    int position; ///< Position of the KmerFreq in the Profile
+};
 
 Profile::Profile(): _profileId("unknown") {
 
@@ -41,6 +240,18 @@ Profile::Profile(const Profile& orig) {
     copy(orig);
 }
 
+Profile::Profile(Profile&& orig) noexcept : _profileId(std::move(orig._profileId)),
+_vectorKmerFreq(orig._vectorKmerFreq), _size(orig._size), _capacity(orig._capacity),
+_index(std::move(orig._index)), _indexSize(orig._indexSize),
+_ranks(std::move(orig._ranks)), _rankAlphabet(std::move(orig._rankAlphabet)),
+_ranksSize(orig._ranksSize) {
+
+    orig._vectorKmerFreq = nullptr;
+    orig._size = 0;
+    orig._capacity = 0;
+    orig.invalidateIndex();
+}
+
 Profile::~Profile() {
     
     deallocate();
@@ -48,12 +259,40 @@ Profile::~Profile() {
 
 Profile& Profile::operator=(const Profile& orig) {
   
-    if (&orig != this)
+    if (&orig != this) {
+        if (orig.getSize() > getCapacity()) {
+            deallocate();
+            allocate(orig.getCapacity());
+        }
         copy(orig);
+    }
     
     return *this;
 }
 
+Profile& Profile::operator=(Profile&& orig) noexcept {
+
+    if (&orig != this) {
+        delete[] _vectorKmerFreq;
+        _profileId = std::move(orig._profileId);
+        _vectorKmerFreq = orig._vectorKmerFreq;
+        _size = orig._size;
+        _capacity = orig._capacity;
+        _index = std::move(orig._index);
+        _indexSize = orig._indexSize;
+        _ranks = std::move(orig._ranks);
+        _rankAlphabet = std::move(orig._rankAlphabet);
+        _ranksSize = orig._ranksSize;
+
+        orig._vectorKmerFreq = nullptr;
+        orig._size = 0;
+        orig._capacity = 0;
+        orig.invalidateIndex();
+    }
+
+    return *this;
+}
+
 const std::string& Profile::getProfileId() const {
     
     return _profileId;
@@ -83,6 +322,7 @@ KmerFreq& Profile::at(int index) {
     else if (index >= getSize()) 
         throw std::out_of_range("KmerFreq& Profile::at (int index): index is  greater than _size");
     
+    invalidateIndex();
     return _vectorKmerFreq[index];
 }
 
@@ -96,12 +336,62 @@ int Profile::getCapacity() const {
     return _capacity;
 }
 
+void Profile::reserve(int capacity) {
+
+    if (capacity > getCapacity())
+        reallocate(capacity);
+}
+
+void Profile::shrinkToFit() {
+
+    if (getSize() < getCapacity())
+        reallocate(getSize());
+}
+
 double Profile::getDistance(const Profile& otherProfile) const {
     
     int size_1 = getSize(), size_2 = otherProfile.getSize();
     if (size_1 == 0 || size_2 == 0) 
         throw std::invalid_argument("double Profile::getDistance(const Profile& otherProfile) const: the implicit object or the argument Profile object are empty, that is, they do not have any kmer");
     
+    // The ranks in otherProfile are taken from its rank table, if it has 
+    // one, with a lookup for each kmer. Otherwise, each kmer is searched in
+    // its hash index. Both give the first position of a repeated kmer
+    if (otherProfile._index.empty() || otherProfile._indexSize != size_2)
+        otherProfile.buildIndex();
+    else if (otherProfile._ranksSize != size_2)
+        otherProfile.buildRankTable();
+
+    if (!otherProfile._ranks.empty()) {
+        const int NUM_CHARACTERS = 256;
+        const std::string& alphabet = otherProfile._rankAlphabet;
+        int digits[NUM_CHARACTERS];
+        std::fill(digits, digits + NUM_CHARACTERS, -1);
+        for (size_t digit = 0; digit < alphabet.size(); digit++)
+            digits[static_cast<unsigned char>(alphabet[digit])] = digit;
+        int base = alphabet.size();
+        int k = otherProfile.at(0).getKmer().size();
+
+        // A kmer with another length or nucleotide is not in otherProfile
+        long long sum = 0;
+        for (int i = 0; i < size_1; i++) {
+            const Kmer& kmer = at(i).getKmer();
+            int rank = size_2;
+            if (kmer.size() == k) {
+                int code = 0;
+                for (int j = 0; j < k && code >= 0; j++) {
+                    int digit = digits[static_cast<unsigned char>(kmer[j])];
+                    code = digit < 0 ? -1 : code * base + digit;
+                }
+                if (code >= 0)
+                    rank = otherProfile._ranks[code];
+            }
+            sum += abs(i - rank);
+        }
+
+        return (static_cast<double>(sum) / (static_cast<double>(size_1) * size_2));
+    }
+    
     double sum = 0.0;
     for (int i = 0; i < size_1; i++) {
         size_t pos_found = otherProfile.findKmer(at(i).getKmer());
@@ -111,7 +401,7 @@ double Profile::getDistance(const Profile& otherProfile) const {
         else sum += abs(i - pos_found);
     }
     
-    return (sum / (size_1 * size_2));
+    return (sum / (static_cast<double>(size_1) * size_2));
 }
 
 int Profile::findKmer(const Kmer& kmer, int initialPos, int finalPos) const {
@@ -133,7 +423,10 @@ int Profile::findKmer(const Kmer& kmer, int initialPos, int finalPos) const {
 
 int Profile::findKmer(const Kmer& kmer) const {
     
-    return findKmer(kmer, 0, getSize() - 1);
+    if (_index.empty() || _indexSize != getSize())
+        buildIndex();
+    
+    return _index[findSlot(kmer)];
 }
 
 std::string Profile::toString() const {
@@ -146,23 +439,57 @@ std::string Profile::toString() const {
     return string; 
 }
 
-void Profile::sort() {
+void Profile::sort(int numThreads) {
     
-    KmerFreq insert;
     int size = getSize();
-    for (int left = 1; left < size; left++) {
-        insert = at(left);
-        int i = left;
-        while(i > 0 && insert > at(i - 1)) {
-            at(i) = at(i - 1);
-            i--;  
+    if (size < 2)
+        return;
+
+    // If all the kmers have the same length, each kmer gets a code whose
+    // order is the order of the kmers
+    std::string alphabet;
+    std::vector<unsigned long long> codes;
+    bool packed = packKmers(alphabet, codes);
+
+    // The position of each KmerFreq in the sorted vector. Both sorts are
+    // stable, as the insertion sort used before
+    std::vector<int> order(size);
+    if (packed) {
+        std::vector<SortKey> keys(size);
+        for (int i = 0; i < size; i++) {
+            keys[i].code = codes[i];
+            keys[i].frequency = _vectorKmerFreq[i].getFrequency();
+            keys[i].position = i;
         }
-        
-        at(i) = insert; 
+        RadixSortByFrequency(keys,
+                [](const SortKey& key) { return key.code; },
+                [](const SortKey& key) { return key.frequency; }, numThreads);
+        for (int i = 0; i < size; i++)
+            order[i] = keys[i].position;
     }
+    else {
+        std::vector<std::string> kmers(size);
+        for (int i = 0; i < size; i++) {
+            kmers[i] = _vectorKmerFreq[i].getKmer().toString();
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int pos1, int pos2) {
+            long long frequency1 = _vectorKmerFreq[pos1].getFrequency();
+            long long frequency2 = _vectorKmerFreq[pos2].getFrequency();
+            return frequency1 > frequency2 || 
+                    (frequency1 == frequency2 && kmers[pos1] < kmers[pos2]);
+        });
+    }
+
+    KmerFreq* sorted = new KmerFreq[getCapacity()];
+    for (int i = 0; i < size; i++)
+        sorted[i] = std::move(_vectorKmerFreq[order[i]]);
+    delete[] _vectorKmerFreq;
+    _vectorKmerFreq = sorted;
+    invalidateIndex();
 }
 
-void Profile::save(const char fileName[], char mode) const {
+void Profile::save(const char fileName[], char mode, int numThreads) const {
         
     if (mode != 't' && mode != 'b')
         throw std::invalid_argument("void Profile::save(const char fileName[], char mode) const: the given mode is not valid ('t' or 'b')");
@@ -174,14 +501,26 @@ void Profile::save(const char fileName[], char mode) const {
             throw std::ios_base::failure("void Profile::save(const char fileName[]) const: the given file cannot be opened");
         }
         
-        if (mode == 't')
-            output << MAGIC_STRING_T << std::endl << *this;
+        std::string alphabet;
+        std::vector<unsigned long long> codes;
+        if (mode == 't') {
+            output << MAGIC_STRING_T << '\n' << getProfileId() << '\n' << getSize();
+            formatText(output, numThreads);
+        }
+        
+        else if (packKmers(alphabet, codes) && getSize() > 0 &&
+                _vectorKmerFreq[0].getKmer().size() <= MAX_PACKED_K)
+            savePacked(output, alphabet, codes);
         
         else {
             int size = getSize();
-            output << MAGIC_STRING_B << std::endl << getProfileId() << std::endl << size << std::endl;
+            bool wideFrequency = false;
+            for (int i = 0; i < size && !wideFrequency; i++)
+                wideFrequency = at(i).getFrequency() > std::numeric_limits<int>::max();
+            output << (wideFrequency ? MAGIC_STRING_B_WIDE : MAGIC_STRING_B) << std::endl 
+                    << getProfileId() << std::endl << size << std::endl;
             for (int i = 0; i < size; i++) {
-                at(i).write(output);
+                at(i).write(output, wideFrequency);
             }    
         }
         
@@ -204,10 +543,27 @@ void Profile::load(const char fileName[]) {
 
     std::string magic_string;
     getline(input,magic_string);
-    if (magic_string == MAGIC_STRING_T)
-        input >> *this;
+    if (magic_string == MAGIC_STRING_T || magic_string == MAGIC_STRING_B_PACKED) {
+        // The file is mapped in memory if possible; otherwise, the rest of 
+        // the file is read at once
+        long long begin = input.tellg();
+        MappedFile mappedFile(fileName);
+        std::string buffer;
+        const char* data = mappedFile.getData() + begin;
+        long long size = mappedFile.getSize() - begin;
+        if (!mappedFile.isMapped()) {
+            buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            data = buffer.data();
+            size = buffer.size();
+        }
+        
+        if (magic_string == MAGIC_STRING_T)
+            loadText(data, size);
+        else
+            loadPacked(data, size);
+    }
     
-    else if (magic_string == MAGIC_STRING_B) {
+    else if (magic_string == MAGIC_STRING_B || magic_string == MAGIC_STRING_B_WIDE) {
         std::string profile;
         getline(input, profile);
         setProfileId(profile);
@@ -222,7 +578,7 @@ void Profile::load(const char fileName[]) {
         for (int i = 0; i < nkmer_freqs; i++) {
             if (input) {
                 KmerFreq kmerFreq;
-                kmerFreq.read(input);
+                kmerFreq.read(input, magic_string == MAGIC_STRING_B_WIDE);
                 this->append(kmerFreq);
             }
             
@@ -243,38 +599,55 @@ void Profile::load(const char fileName[]) {
 
 void Profile::append(const KmerFreq& kmerFreq) {
     
+    // The array is accessed directly, so that the index is kept
     size_t foundPos = findKmer(kmerFreq.getKmer());
     if (foundPos == std::string::npos) {
-        if (getSize() == getCapacity()) 
-            reallocate(getSize() + 1);
+        grow(getSize() + 1);
         
-        this->operator[](getSize()) = kmerFreq;
+        _vectorKmerFreq[getSize()] = kmerFreq;
         _size++;
+        addToIndex(getSize() - 1);
     }
     
     else 
-        at(foundPos).setFrequency(at(foundPos).getFrequency() + kmerFreq.getFrequency());      
+        _vectorKmerFreq[foundPos].setFrequency(_vectorKmerFreq[foundPos].getFrequency() + kmerFreq.getFrequency());      
 }
 
 void Profile::normalize(const std::string& validNucleotides) {
     
     int size = getSize();   
     for (int i = 0; i < size; i++) {
-        Kmer kmer = at(i).getKmer();
+        Kmer kmer = _vectorKmerFreq[i].getKmer();
         kmer.normalize(validNucleotides);
-        at(i).setKmer(kmer);
+        _vectorKmerFreq[i].setKmer(kmer);
     }
-      
-    int i = 1;
-    while (i < getSize()) {
-        size_t index = findKmer(at(i).getKmer(), 0, i - 1);
-        if (index != std::string::npos) {
-            at(index).setFrequency(at(index).getFrequency() + at(i).getFrequency());
-            deletePos(i);
+    mergeRepeated();
+}
+
+void Profile::mergeRepeated() {
+
+    // Each kmer is searched in the index of the kmers kept before it: if it
+    // is found, its frequency is added to the first occurrence; otherwise,
+    // it is moved to the next kept position. At the end, the index is valid
+    int size = getSize();
+    clearIndex(size);
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        size_t slot = findSlot(_vectorKmerFreq[i].getKmer());
+        if (_index[slot] >= 0) {
+            KmerFreq& first = _vectorKmerFreq[_index[slot]];
+            first.setFrequency(first.getFrequency() + _vectorKmerFreq[i].getFrequency());
         }
        
-        else i++;
+        else {
+            if (kept != i)
+                _vectorKmerFreq[kept] = std::move(_vectorKmerFreq[i]);
+            _index[slot] = kept;
+            kept++;
+        }
     } 
+    _size = kept;
+    _indexSize = kept;
 }
 
 void Profile::deletePos(int pos) {
@@ -286,27 +659,73 @@ void Profile::deletePos(int pos) {
     else if (pos >= size) 
         throw std::out_of_range("void Profile::deletePos(int pos): pos is greater than _size");
     
+    invalidateIndex();
     for (int i = pos; i < size - 1; i++) 
         at(i) = at(i + 1);  
 
     _size--;
 }
 
-void Profile::zip(bool deleteMissing, int lowerBound) {
+void Profile::zip(bool deleteMissing, int lowerBound, int numThreads) {
   
-    int i = 0;
-    while (i < getSize()) {
-        if ((deleteMissing && (at(i).getKmer().toString().find(Kmer::MISSING_NUCLEOTIDE) != std::string::npos))||
-            (at(i).getFrequency() <= lowerBound)) 
-            deletePos(i);
-        
-        else i++;
-    }   
+    int size = getSize();
+    auto keep = [deleteMissing, lowerBound](const KmerFreq& kmerFreq) {
+        return !((deleteMissing && (kmerFreq.getKmer().toString().find(Kmer::MISSING_NUCLEOTIDE) != std::string::npos)) ||
+                (kmerFreq.getFrequency() <= lowerBound));
+    };
+
+    numThreads = std::max(1, std::min(numThreads, size / MIN_ZIP_ELEMENTS_PER_THREAD));
+    if (numThreads == 1) {
+        // The kept objects are moved from the reading position (i) to the
+        // writing position (kept)
+        int kept = 0;
+        for (int i = 0; i < size; i++)
+            if (keep(_vectorKmerFreq[i])) {
+                if (kept != i)
+                    _vectorKmerFreq[kept] = std::move(_vectorKmerFreq[i]);
+                kept++;
+            }
+        _size = kept;
+    }
+    
+    else {
+        // Each thread marks the objects of its part that are kept, and then
+        // copies them after the ones kept by the previous threads
+        std::vector<char> kept(size);
+        std::vector<int> numKept(numThreads + 1, 0);
+        ParallelFor(numThreads, [&](int t) {
+            int last = GetPartBegin(size, numThreads, t + 1);
+            for (int i = GetPartBegin(size, numThreads, t); i < last; i++) {
+                kept[i] = keep(_vectorKmerFreq[i]);
+                numKept[t + 1] += kept[i];
+            }
+        });
+        for (int t = 0; t < numThreads; t++)
+            numKept[t + 1] += numKept[t];
+
+        KmerFreq* zipped = new KmerFreq[std::max(numKept[numThreads], 1)];
+        ParallelFor(numThreads, [&](int t) {
+            int position = numKept[t];
+            int last = GetPartBegin(size, numThreads, t + 1);
+            for (int i = GetPartBegin(size, numThreads, t); i < last; i++)
+                if (kept[i])
+                    zipped[position++] = std::move(_vectorKmerFreq[i]);
+        });
+        delete[] _vectorKmerFreq;
+        _vectorKmerFreq = zipped;
+        _capacity = std::max(numKept[numThreads], 1);
+        _size = numKept[numThreads];
+    }
+
+    if (getSize() < getCapacity() / 2)
+        shrinkToFit();
+    invalidateIndex();
 } 
 
 void Profile::join(const Profile& profile) {
       
     int size = profile.getSize();
+    grow(getSize() + size);
     for (int i = 0; i < size; i++) 
         append(profile.at(i));
 }
@@ -318,6 +737,7 @@ const KmerFreq& Profile::operator[](int index) const {
 
 KmerFreq& Profile::operator[](int index) {
     
+    invalidateIndex();
     return _vectorKmerFreq[index];
 }
 
@@ -330,6 +750,7 @@ Profile& Profile::operator+=(const KmerFreq& kmerFreq) {
 Profile& Profile::operator+=(const Profile& profile) {
     
     int size = profile.getSize();
+    grow(getSize() + size);
     for (int i = 0; i < size; i++) 
         append(profile.at(i));
     
@@ -349,6 +770,7 @@ void Profile::allocate(int capacity) {
     
     _size = 0;
     _capacity = capacity;
+    invalidateIndex();
 }
 
 void Profile::deallocate() {
@@ -363,6 +785,7 @@ void Profile::reallocate(int capacity) {
 
     int size = getSize();
     if (capacity == 0) {
+        delete[] _vectorKmerFreq;
         _vectorKmerFreq = nullptr;
         _capacity = 0;
         _size = 0;
@@ -375,18 +798,22 @@ void Profile::reallocate(int capacity) {
         throw std::out_of_range("void Profile::reallocate(int capacity): capacity is less than current _size");
     
     else {
-        while (getCapacity() < capacity)
-            _capacity += BLOCK_SIZE;
-
+        _capacity = capacity;
         KmerFreq* kmerfreq = new KmerFreq[getCapacity()];
         for (int i = 0; i < size; i++)
-            kmerfreq[i] = at(i);
+            kmerfreq[i] = std::move(_vectorKmerFreq[i]);
 
         delete[] _vectorKmerFreq;
         _vectorKmerFreq = kmerfreq;
     }
 }
 
+void Profile::grow(int size) {
+
+    if (size > getCapacity())
+        reallocate(std::max(size, std::max(2 * getCapacity(), getCapacity() + BLOCK_SIZE)));
+}
+
 void Profile::copy(const Profile& profile) {
     
     setProfileId(profile.getProfileId());
@@ -394,14 +821,308 @@ void Profile::copy(const Profile& profile) {
         _vectorKmerFreq[i] = profile[i];
 
     _size = profile.getSize();
+    invalidateIndex();
+}
+
+bool Profile::packKmers(std::string& alphabet, std::vector<unsigned long long>& codes) const {
+
+    const int NUM_CHARACTERS = 256;
+    int size = getSize();
+    if (size == 0)
+        return false;
+
+    bool used[NUM_CHARACTERS] = {false};
+    int k = _vectorKmerFreq[0].getKmer().size();
+    for (int i = 0; i < size; i++) {
+        const Kmer& kmer = _vectorKmerFreq[i].getKmer();
+        if (kmer.size() != k)
+            return false;
+        for (int j = 0; j < k; j++)
+            used[static_cast<unsigned char>(kmer[j])] = true;
+    }
+
+    unsigned long long ranks[NUM_CHARACTERS];
+    alphabet.clear();
+    for (int c = 0; c < NUM_CHARACTERS; c++)
+        if (used[c]) {
+            ranks[c] = alphabet.size();
+            alphabet.push_back(c);
+        }
+    unsigned long long base = alphabet.size(), numCodes = 1;
+    for (int j = 0; j < k; j++) {
+        if (numCodes > std::numeric_limits<unsigned long long>::max() / base)
+            return false;
+        numCodes *= base;
+    }
+
+    codes.resize(size);
+    for (int i = 0; i < size; i++) {
+        const Kmer& kmer = _vectorKmerFreq[i].getKmer();
+        unsigned long long code = 0;
+        for (int j = 0; j < k; j++)
+            code = code * base + ranks[static_cast<unsigned char>(kmer[j])];
+        codes[i] = code;
+    }
+
+    return true;
+}
+
+void Profile::savePacked(std::ostream& outputStream, const std::string& alphabet,
+        const std::vector<unsigned long long>& codes) const {
+
+    int size = getSize();
+    std::vector<unsigned long long> frequencies(size);
+    for (int i = 0; i < size; i++)
+        frequencies[i] = _vectorKmerFreq[i].getFrequency();
+
+    PackedHeader header;
+    header.numKmers = size;
+    header.k = _vectorKmerFreq[0].getKmer().size();
+    header.alphabetSize = alphabet.size();
+    header.idSize = getProfileId().size();
+    header.flags = NativeByteOrder();
+    header.checksum = Checksum(frequencies.data(), size, Checksum(codes.data(), size));
+
+    // The magic string line is followed by the padding up to the header
+    const char padding[PACKED_ALIGNMENT] = {0};
+    long long position = MAGIC_STRING_B_PACKED.size() + 1;
+    outputStream << MAGIC_STRING_B_PACKED << '\n';
+    outputStream.write(padding, Padding(position));
+    outputStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outputStream.write(alphabet.data(), alphabet.size());
+    outputStream.write(getProfileId().data(), getProfileId().size());
+    outputStream.write(padding, Padding(alphabet.size() + getProfileId().size()));
+    outputStream.write(reinterpret_cast<const char*>(codes.data()), size * sizeof(unsigned long long));
+    outputStream.write(reinterpret_cast<const char*>(frequencies.data()), size * sizeof(unsigned long long));
+}
+
+void Profile::loadPacked(const char* data, long long size) {
+
+    // The data starts after the magic string line, so the sections are 
+    // aligned relative to the beginning of the file
+    long long position = Padding(MAGIC_STRING_B_PACKED.size() + 1);
+    PackedHeader header;
+    if (size < position + static_cast<long long>(sizeof(header)))
+        throw std::invalid_argument("void Profile::load(const char fileName[]): the packed binary file has an invalid size or header");
+    std::memcpy(&header, data + position, sizeof(header));
+    position += sizeof(header);
+    if ((header.flags & PACKED_BYTE_ORDER) != NativeByteOrder())
+        throw std::invalid_argument("void Profile::load(const char fileName[]): the packed binary file was saved with a different byte order");
+
+    const int NUM_CHARACTERS = 256;
+    unsigned long long numCodes = 0;
+    long long textSize = static_cast<long long>(header.alphabetSize) + header.idSize;
+    if (header.numKmers < 0 || header.numKmers > std::numeric_limits<int>::max() ||
+            header.k < 1 || header.alphabetSize < 1 || 
+            header.alphabetSize > NUM_CHARACTERS || header.idSize < 0 ||
+            !PackedNumCodes(header.k, header.alphabetSize, numCodes) ||
+            size != position + textSize + Padding(textSize) + 
+                2 * header.numKmers * static_cast<long long>(sizeof(unsigned long long)))
+        throw std::invalid_argument("void Profile::load(const char fileName[]): the packed binary file has an invalid size or header");
+
+    std::string alphabet(data + position, header.alphabetSize);
+    setProfileId(std::string(data + position + header.alphabetSize, header.idSize));
+    position += textSize + Padding(textSize);
+
+    // The columns are copied, since the data may not be aligned in memory
+    int numKmers = header.numKmers;
+    std::vector<unsigned long long> codes(numKmers), frequencies(numKmers);
+    std::memcpy(codes.data(), data + position, numKmers * sizeof(unsigned long long));
+    position += numKmers * sizeof(unsigned long long);
+    std::memcpy(frequencies.data(), data + position, numKmers * sizeof(unsigned long long));
+    if (Checksum(frequencies.data(), numKmers, Checksum(codes.data(), numKmers)) != header.checksum)
+        throw std::invalid_argument("void Profile::load(const char fileName[]): the checksum of the packed binary file is not valid");
+    for (int i = 0; i < numKmers; i++)
+        if (codes[i] >= numCodes)
+            throw std::invalid_argument("void Profile::load(const char fileName[]): the packed binary file has an invalid kmer code");
+
+    deallocate();
+    allocate(numKmers);
+    unsigned long long base = alphabet.size();
+    std::string text(header.k, Kmer::MISSING_NUCLEOTIDE);
+    for (int i = 0; i < numKmers; i++) {
+        unsigned long long code = codes[i];
+        for (int j = header.k - 1; j >= 0; j--) {
+            text[j] = alphabet[code % base];
+            code /= base;
+        }
+        _vectorKmerFreq[i].setKmer(Kmer(text));
+        _vectorKmerFreq[i].setFrequency(frequencies[i]);
+    }
+    _size = numKmers;
+    mergeRepeated();
+}
+
+void Profile::loadText(const char* data, long long size) {
+
+    const char* end = data + size;
+    const char* position = std::find(data, end, '\n');
+    setProfileId(std::string(data, position));
+    if (position != end)
+        position++;
+
+    long long nkmer_freqs;
+    if (!ParseNumber(position, end, nkmer_freqs) || nkmer_freqs > std::numeric_limits<int>::max())
+        throw std::ios_base::failure("void Profile::load(const char fileName[]): an error ocurred while reading from the file");
+    if (nkmer_freqs < 0)    
+        throw std::out_of_range("void Profile::load(const char fileName[]): the number of kmers in the given file is negative");
+
+    allocate(nkmer_freqs);
+    for (int i = 0; i < nkmer_freqs; i++) {
+        const char* kmer = SkipSpaces(position, end);
+        const char* kmerEnd = kmer;
+        while (kmerEnd != end && !IsSpace(*kmerEnd))
+            kmerEnd++;
+        position = kmerEnd;
+        long long frequency;
+        if (kmer == kmerEnd || !ParseNumber(position, end, frequency))
+            throw std::ios_base::failure("void Profile::load(const char fileName[]): an error ocurred while reading from the file");
+
+        _vectorKmerFreq[i].setKmer(Kmer(std::string(kmer, kmerEnd)));
+        _vectorKmerFreq[i].setFrequency(frequency);
+        _size++;
+    }
+    mergeRepeated();
+}
+
+void Profile::formatText(std::ostream& outputStream, int numThreads) const {
+
+    int size = getSize();
+    int numBlocks = (size + WRITE_BLOCK_SIZE - 1) / WRITE_BLOCK_SIZE;
+    numThreads = std::max(1, std::min(numThreads, numBlocks));
+    std::vector<std::string> buffers(numThreads);
+    for (int firstBlock = 0; firstBlock < numBlocks; firstBlock += numThreads) {
+        ParallelFor(numThreads, [&](int t) {
+            std::string& buffer = buffers[t];
+            buffer.clear();
+            long long first = static_cast<long long>(firstBlock + t) * WRITE_BLOCK_SIZE;
+            long long last = std::min(first + WRITE_BLOCK_SIZE, static_cast<long long>(size));
+            for (long long i = first; i < last; i++) {
+                buffer += '\n';
+                buffer += _vectorKmerFreq[i].getKmer().toString();
+                buffer += ' ';
+                AppendNumber(buffer, _vectorKmerFreq[i].getFrequency());
+            }
+        });
+        for (int t = 0; t < numThreads; t++)
+            outputStream.write(buffers[t].data(), buffers[t].size());
+    }
+}
+
+size_t Profile::findSlot(const Kmer& kmer) const {
+
+    size_t mask = _index.size() - 1;
+    size_t slot = std::hash<Kmer>()(kmer) & mask;
+    while (_index[slot] >= 0 && !(_vectorKmerFreq[_index[slot]].getKmer() == kmer))
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+void Profile::clearIndex(int numKmers) const {
+
+    // The capacity is at least twice the number of kmers (and the next one)
+    size_t capacity = MIN_INDEX_CAPACITY;
+    while (capacity < 2 * (static_cast<size_t>(numKmers) + 1))
+        capacity *= 2;
+    _index.assign(capacity, -1);
+    _indexSize = 0;
+    _ranks.clear();
+    _rankAlphabet.clear();
+    _ranksSize = -1;
+}
+
+void Profile::buildIndex() const {
+
+    clearIndex(getSize());
+    for (int i = 0; i < getSize(); i++) {
+        size_t slot = findSlot(_vectorKmerFreq[i].getKmer());
+        if (_index[slot] < 0)
+            _index[slot] = i;
+    }
+    _indexSize = getSize();
+    buildRankTable();
+}
+
+void Profile::buildRankTable() const {
+
+    // The digits of the codes are the nucleotides in their order of 
+    // appearance. The table is not built if it would be much bigger than the
+    // Profile, since it would be filled and then read out of the cache for
+    // just a few kmers
+    const int NUM_CHARACTERS = 256;
+    int size = getSize();
+    _ranks.clear();
+    _rankAlphabet.clear();
+    _ranksSize = size;
+    if (size == 0)
+        return;
+
+    int digits[NUM_CHARACTERS];
+    std::fill(digits, digits + NUM_CHARACTERS, -1);
+    std::string alphabet;
+    int k = _vectorKmerFreq[0].getKmer().size();
+    for (int i = 0; i < size; i++) {
+        const Kmer& kmer = _vectorKmerFreq[i].getKmer();
+        if (kmer.size() != k)
+            return;
+        for (int j = 0; j < k; j++) {
+            unsigned char nucleotide = kmer[j];
+            if (digits[nucleotide] < 0) {
+                digits[nucleotide] = alphabet.size();
+                alphabet += nucleotide;
+            }
+        }
+    }
+
+    long long base = alphabet.size();
+    long long maxCodes = std::min(static_cast<long long>(MAX_RANK_TABLE_SIZE),
+            static_cast<long long>(RANK_TABLE_FACTOR) * size);
+    long long numCodes = 1;
+    for (int j = 0; j < k; j++) {
+        numCodes *= base;
+        if (numCodes > maxCodes)
+            return;
+    }
+
+    // The first occurrence of a repeated kmer is saved at the end
+    _ranks.assign(numCodes, size);
+    for (int i = size - 1; i >= 0; i--) {
+        const Kmer& kmer = _vectorKmerFreq[i].getKmer();
+        int code = 0;
+        for (int j = 0; j < k; j++)
+            code = code * base + digits[static_cast<unsigned char>(kmer[j])];
+        _ranks[code] = i;
+    }
+    _rankAlphabet = alphabet;
+}
+
+void Profile::addToIndex(int pos) {
+
+    if (_index.empty() || _indexSize != pos)
+        return;
+
+    if (2 * (static_cast<size_t>(pos) + 1) > _index.size())
+        buildIndex();
+    else {
+        _index[findSlot(_vectorKmerFreq[pos].getKmer())] = pos;
+        _indexSize++;
+    }
+}
+
+void Profile::invalidateIndex() {
+
+    _index.clear();
+    _indexSize = 0;
+    _ranks.clear();
+    _rankAlphabet.clear();
+    _ranksSize = -1;
 }
 
 std::ostream& operator<<(std::ostream& os, const Profile& profile) {
     
-    int size = profile.getSize();
-    os << profile.getProfileId() << std::endl << size;
-    for (int i = 0; i < size; i++)
-        os << std::endl << profile.at(i);
+    os << profile.getProfileId() << '\n' << profile.getSize();
+    profile.formatText(os);
 
     return os;
 }
@@ -421,7 +1142,7 @@ std::istream& operator>>(std::istream& is, Profile& profile) {
     for (int i = 0; i < nkmer_freqs; i++) {
         KmerFreq kmerFreq;
         Kmer kmer;
-        int frequency;
+        long long frequency;
         is >> kmer >> frequency;
         kmerFreq.setKmer(kmer);
         kmerFreq.setFrequency(frequency);